@@ -0,0 +1,76 @@
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+#include "anim.h"
+#include "display.h"
+#include "sched.h"
+#include "buttons.h"
+#include "font.h"
+
+static uint8_t back;	// where the back page starts
+static uint8_t span;	// the animation's width
+
+// column x of the frame is w; repeat it across the display if the animation is narrow
+static void put(uint8_t x, uint16_t w)
+{
+	for (; x < DISPLAY_WIDTH; x += span)
+		fb_write((back + x) & FB_MASK, w);
+}
+
+uint8_t play_anim(const uint8_t *p, uint16_t frames, uint8_t width)
+{
+	uint16_t tick;
+	uint8_t i;
+
+	scroll_wait();
+	span = width;
+
+	// start from a blank screen, which is what the first frame is coded against
+	clear_screen(0, FB_COLS);
+	display_update();
+
+	tick = now();
+	while (frames-- > 0)
+	{
+		uint8_t head = pgm_read_byte(p++);
+		back = (fb_base + DISPLAY_WIDTH) & FB_MASK;
+
+		// the back page carries the last frame forward, unchanged columns and all
+		for (i = 0; i < DISPLAY_WIDTH; ++i)
+			fb_write((back + i) & FB_MASK, framebuf[(fb_base + i) & FB_MASK]);
+
+		if (head & ANIM_RLE)
+		{
+			uint8_t x = 0;
+			while (x < width)
+			{
+				uint8_t n = pgm_read_byte(p);
+				uint16_t w = pgm_read_word(p + 1);
+				p += 3;
+				while (n-- > 0)
+					put(x++, w);
+			}
+		}
+		else
+		{
+			const uint8_t *map = p;
+			p += (width + 7) / 8;
+			for (i = 0; i < width; ++i)
+			{
+				if (pgm_read_byte(map + i / 8) & (1 << (i & 7)))
+				{
+					put(i, pgm_read_word(p));
+					p += 2;
+				}
+			}
+		}
+
+		queue_flip(back);
+
+		tick += (head & ~ANIM_RLE) * MILLIS(10);
+		sleep_until(tick);
+		if (GetButtons())
+			return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,26 @@
+#ifndef ANIM_H
+#define ANIM_H
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+#include "assets.h"	// animations are built from sprite sheets by tools/assetgen (ANIMS in the Makefile)
+
+// an animation is a string of frames in flash.  each one starts with a byte giving
+// how long to show it in 10ms ticks, with ANIM_RLE set if the frame is run-length coded:
+// - RLE: (count, lo, hi) runs of the same column word, until the width is covered.
+// - otherwise it's a delta against the previous frame (the first against a blank one):
+//   a bitmap of the changed columns, (width + 7) / 8 bytes with bit 0 of the first byte
+//   for the leftmost column, followed by the new lo, hi for each changed column.
+// the encoder picks whichever is smaller for each frame.
+#define ANIM_RLE 0x80
+
+// plays an animation once, width columns wide; narrower ones are tiled across the display.
+// frames are decoded into the back page and flipped in.  returns 1 if a button cut it short.
+uint8_t play_anim(const uint8_t *p, uint16_t frames, uint8_t width);
+
+// PlayAnim(pacman, PACMAN) for the animation called pacman
+// (the name is upper-cased in the ANIM_ constants, so pass both)
+#define PlayAnim(name, NAME) play_anim(anim_##name, ANIM_##NAME##_FRAMES, ANIM_##NAME##_WIDTH)
+
+#endif
@@ -0,0 +1,94 @@
+// interrupt-driven button input
+//
+// a pin change on either button disables the pin change interrupt and starts timer2,
+// which samples the buttons every BUTTON_TICK while any of them is down.  so bounces
+// are ignored, nothing runs at all while the buttons are idle, and events wait in a
+// queue until the main loop gets around to them.
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "buttons.h"
+#include "sched.h"
+
+#define QUEUE_LEN 4	// power of 2
+static volatile struct button_event queue[QUEUE_LEN];
+static volatile uint8_t q_head, q_tail;
+
+static uint8_t state = 3;	// debounced PINC4/5 (1 = up)
+static uint8_t held;		// ticks since state last changed
+static uint8_t hold_sent;
+
+// ISR side of the queue; drops the event if the main loop isn't keeping up
+static void post(uint8_t buttons)
+{
+	uint8_t h = q_head, next = (h + 1) & (QUEUE_LEN - 1);
+	if (next == q_tail)
+		return;
+	queue[h].buttons = buttons;
+	queue[h].ticks = held;
+	queue[h].when = now();
+	q_head = next;
+}
+
+ISR(PCINT1_vect)
+{
+	// something moved; stop listening to the bounce and have a look once it settles
+	PCMSK1 = 0;
+	TCNT2 = 0;
+	TIFR2 = (1<<OCF2A);
+	TIMSK2 = (1<<OCIE2A);
+	TCCR2B = (1<<CS22) | (1<<CS21) | (1<<CS20);	// 1/1024 prescaler
+}
+
+ISR(TIMER2_COMPA_vect)
+{
+	uint8_t cur = (PINC & 0x30) >> 4;
+
+	if (cur != state) {
+		uint8_t released = ~state & cur;
+		if (released && !hold_sent)
+			post(released);
+		state = cur;
+		held = 0;
+	}
+	else if (cur != 3 && !hold_sent && ++held == HOLD_TICKS) {
+		post(BUTTON_HOLD | (~cur & 3));
+		hold_sent = 1;
+	}
+
+	if (cur == 3) {
+		// all buttons are up; go back to waiting for a pin change
+		hold_sent = 0;
+		TCCR2B = 0;
+		TIMSK2 = 0;
+		PCIFR = (1<<PCIF1);
+		PCMSK1 = (1<<PCINT12) | (1<<PCINT13);
+	}
+}
+
+void buttons_init(void)
+{
+	TCCR2A = (1<<WGM21);		// CTC mode, started by the pin change
+	OCR2A = BUTTON_TICK - 1;
+	PCMSK1 = (1<<PCINT12) | (1<<PCINT13);
+	PCICR |= (1<<PCIE1);
+}
+
+uint8_t GetButtonEvent(struct button_event *e)
+{
+	uint8_t t = q_tail;
+	if (t == q_head)
+		return 0;
+	e->buttons = queue[t].buttons;
+	e->ticks = queue[t].ticks;
+	e->when = queue[t].when;
+	q_tail = (t + 1) & (QUEUE_LEN - 1);
+	return 1;
+}
+
+uint8_t GetButtons(void)
+{
+	struct button_event e;
+	return GetButtonEvent(&e) ? e.buttons : 0;
+}
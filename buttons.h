@@ -0,0 +1,37 @@
+#ifndef BUTTONS_H
+#define BUTTONS_H
+
+#include <stdint.h>
+
+// here's how button presses work:
+// - a press is registered when a button is released.
+// - a hold is registered when the same button has been down
+//   for HOLD_TICKS.  the button release following the hold
+//   does not register.
+
+#define BUTTON_LEFT  0x01
+#define BUTTON_RIGHT 0x02
+#define BUTTON_HOLD  0x10 	// button was held
+
+// the buttons are sampled every BUTTON_TICK kiloclocks (~10ms),
+// but only while a pin change says something is going on.
+#define BUTTON_TICK 78
+#define HOLD_TICKS 100
+
+struct button_event
+{
+	uint8_t buttons;	// BUTTON_* bits
+	uint8_t ticks;		// how long the button was down, in BUTTON_TICKs
+	uint16_t when;		// when it happened, per now()
+};
+
+// enable the pin change interrupt on the buttons
+void buttons_init(void);
+
+// takes the oldest event from the queue; returns 0 if there isn't one
+uint8_t GetButtonEvent(struct button_event *e);
+
+// same, but just the BUTTON_* bits (0 if nothing happened)
+uint8_t GetButtons(void);
+
+#endif
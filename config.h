@@ -0,0 +1,61 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+// build-time configuration: the display's geometry and color depth, and the Life world.
+// everything that depends on them takes its sizes and masks from here, so they're all
+// constants and each variant gets code for just its own layout.  set them with -D in the
+// Makefile's OPTIONS.  (plain #defines only: display_asm.S includes this too.)
+
+// a panel is 8x8, and the columns are driven from the 8 bits of PORTD, so these are fixed
+#define PANEL_COLS 8
+#define PANEL_ROWS 8
+
+// -DDISPLAY_PANELS=n (1, 2, 4 or 8) drives n panels side by side.
+// the panels share the column drivers, and their row shift registers are chained:
+// the row data line feeds the leftmost panel, whose last 595 feeds the next panel
+// to the right, and so on.  so each column refresh shifts out one word per panel.
+#ifndef DISPLAY_PANELS
+#define DISPLAY_PANELS 1
+#endif
+
+#if DISPLAY_PANELS != 1 && DISPLAY_PANELS != 2 && DISPLAY_PANELS != 4 && DISPLAY_PANELS != 8
+#error "DISPLAY_PANELS must be 1, 2, 4 or 8"
+#endif
+
+#define DISPLAY_WIDTH (PANEL_COLS * DISPLAY_PANELS)	// visible columns
+#define FB_COLS (2 * DISPLAY_WIDTH)		// two pages' worth
+#define FB_MASK (FB_COLS - 1)
+
+// framebuf has PIXEL_BITS per pixel: green and red.  the panels are red/green, with two
+// 595 outputs per row, unless built with -DDISPLAY_MONO for one-color panels with one
+// 595 each; those light a pixel if either of its bits is set, and shift out half as much.
+#define PIXEL_BITS 2
+#ifdef DISPLAY_MONO
+#define ROW_BITS PANEL_ROWS			// bits shifted out per panel per column
+#else
+#define ROW_BITS (PANEL_ROWS * PIXEL_BITS)
+#endif
+
+// -DDISPLAY_BCM_BITS=n (1..4): levels of grayscale per color (see display.h)
+#ifndef DISPLAY_BCM_BITS
+#define DISPLAY_BCM_BITS 1
+#endif
+
+#if DISPLAY_BCM_BITS < 1 || DISPLAY_BCM_BITS > 4
+#error "DISPLAY_BCM_BITS must be 1 to 4"
+#endif
+
+// the Life world is LIFE_COLS x LIFE_ROWS (see life.h).
+// LIFE_COLS can be any power of 2 from 4 to 128; LIFE_ROWS can be 8, 16 or 32.
+#ifndef LIFE_COLS
+#define LIFE_COLS 32
+#endif
+#ifndef LIFE_ROWS
+#define LIFE_ROWS 32
+#endif
+
+#if (LIFE_COLS & (LIFE_COLS - 1)) || LIFE_COLS < 4 || LIFE_COLS > 128
+#error "LIFE_COLS must be a power of 2 from 4 to 128"
+#endif
+
+#endif
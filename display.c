@@ -0,0 +1,460 @@
+// display refresh for the red/green matrix panels
+// (see display.h for the row shift register backends)
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <avr/pgmspace.h>
+#include <string.h>
+
+#include "display.h"
+#include "profile.h"
+#include "sched.h"
+
+volatile uint8_t fb_base = 0;
+volatile uint16_t framebuf[FB_COLS];
+#if DISPLAY_BCM_BITS > 1
+volatile uint16_t framebuf_lo[DISPLAY_BCM_BITS - 1][FB_COLS];
+#endif
+
+// what the refresh ISR actually shifts out: for each bit plane and each of the PANEL_COLS
+// column drivers, ROW_BITS per panel in the order they go down the chain (rightmost panel
+// first), already inverted for the active-low rows.  there are two of these: the ISR shows
+// the front one while display_update() rebuilds the other, and swaps them at the end of a frame.
+#if ROW_BITS > 8
+typedef uint16_t row_word_t;
+#else
+typedef uint8_t row_word_t;
+#endif
+static volatile row_word_t scanout[2][DISPLAY_BCM_BITS][PANEL_COLS][DISPLAY_PANELS];
+typedef volatile row_word_t (*scanout_t)[PANEL_COLS][DISPLAY_PANELS];
+scanout_t volatile scanout_front = scanout[0];	// (display_asm.S reads this too)
+static volatile uint8_t flip_pending;	// the back scanout is ready to show
+
+#ifdef DISPLAY_ASM
+// the naked refresh ISR's state: the PORTD bit of the next column (PD7 first),
+// and where that column's words start in scanout_front.  r3 is its SREG stash.
+register uint8_t scan_col asm("r2");
+register volatile row_word_t *scan_ptr asm("r4");
+#define SCAN_RESTART() do { scan_col = 0x80; scan_ptr = scanout_front[0][0]; } while (0)
+#else
+#define SCAN_RESTART() do {} while (0)
+#endif
+
+volatile uint8_t display_frames;
+
+#if DISPLAY_BCM_BITS > 1
+
+// bit k of a column is shown for BCM_UNIT << k timer ticks,
+// which adds up to about the same REFRESH period per column.
+#define BCM_UNIT ((REFRESH + 1) / ((1 << DISPLAY_BCM_BITS) - 1))
+
+static const uint8_t bcm_top[DISPLAY_BCM_BITS] =
+{
+	BCM_UNIT - 1, 2 * BCM_UNIT - 1,
+#if DISPLAY_BCM_BITS > 2
+	4 * BCM_UNIT - 1,
+#endif
+#if DISPLAY_BCM_BITS > 3
+	8 * BCM_UNIT - 1,
+#endif
+};
+
+// the fade cutoff for each plane
+static volatile uint8_t fade_top[DISPLAY_BCM_BITS];
+
+void display_fade(uint8_t level)
+{
+	uint8_t k;
+	for(k = 0; k < DISPLAY_BCM_BITS; ++k)
+	{
+		uint8_t t = (uint16_t)level * (bcm_top[k] + 1) / (REFRESH + 1);
+		// at the top a cutoff on the plane's own compare would blank it for the whole slot
+		if (t >= bcm_top[k])
+			t = bcm_top[k] - 1;
+		fade_top[k] = t ? t : 1;
+	}
+}
+
+#else
+
+// below DIM_LEVEL the columns are refreshed at 125000 / 256 = 488Hz instead, which
+// still doesn't flicker, with the cutoff scaled up to match
+#define DIM_LEVEL (REFRESH / 4)
+#define REFRESH_DIM 255
+
+void display_fade(uint8_t level)
+{
+	if (level < DIM_LEVEL) {
+		uint8_t t = (uint16_t)level * (REFRESH_DIM + 1) / (REFRESH + 1);
+		OCR0A = REFRESH_DIM;
+		OCR0B = t ? t : 1;
+	} else {
+		OCR0A = REFRESH;
+		OCR0B = level;
+	}
+}
+
+#endif
+
+// perceived brightness goes roughly with the cube root of the light, so the cutoff for
+// brightness level 4i + (0..3) is dark + (bright - dark) * (i / 63)^3
+#define GAMMA(i) (FADE_DARK + (uint8_t)((uint32_t)(FADE_BRIGHT - FADE_DARK) * (i) * (i) * (i) / (63UL * 63 * 63)))
+#define GAMMA4(i) GAMMA(i), GAMMA(i + 1), GAMMA(i + 2), GAMMA(i + 3)
+
+static const uint8_t gamma_table[64] PROGMEM =
+{
+	GAMMA4(0), GAMMA4(4), GAMMA4(8), GAMMA4(12), GAMMA4(16), GAMMA4(20), GAMMA4(24), GAMMA4(28),
+	GAMMA4(32), GAMMA4(36), GAMMA4(40), GAMMA4(44), GAMMA4(48), GAMMA4(52), GAMMA4(56), GAMMA4(60),
+};
+
+// the fade in progress: the level in 8.16 fixed point, heading for fade_target at
+// fade_rate a kiloclock, and when the last frame was
+static uint32_t fade_pos = (uint32_t)FADE_MAX << 16;
+static uint32_t fade_rate;
+static uint8_t fade_target = FADE_MAX;
+static uint16_t fade_last;
+static volatile uint8_t fade_busy;
+
+static void fade_apply(uint8_t level)
+{
+	if (level == FADE_MAX) {
+		FADE_OFF();
+	} else {
+		display_fade(pgm_read_byte(&gamma_table[level >> 2]));
+		FADE_ON();
+	}
+}
+
+void fade_to(uint8_t level, uint16_t kiloclocks)
+{
+	uint8_t from;
+	uint32_t rate = 0;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		fade_busy = 0;
+		from = fade_pos >> 16;
+	}
+	if (kiloclocks)
+		rate = ((uint32_t)(level > from ? level - from : from - level) << 16) / kiloclocks;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		fade_target = level;
+		if (rate == 0) {
+			fade_pos = (uint32_t)level << 16;
+			fade_apply(level);
+		} else {
+			fade_rate = rate;
+			fade_last = TCNT1;
+			fade_busy = 1;
+		}
+	}
+}
+
+uint8_t fading(void)
+{
+	uint8_t busy;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		// a blank display stops the refresh, and with it the fade: finish it here
+		if (fade_busy && !TCCR0B) {
+			fade_busy = 0;
+			fade_pos = (uint32_t)fade_target << 16;
+			fade_apply(fade_target);
+		}
+		busy = fade_busy;
+	}
+	return busy;
+}
+
+// from the refresh ISR, at the end of every frame
+static inline void fade_step(void)
+{
+	uint16_t t = TCNT1;
+	uint32_t step = fade_rate * (uint16_t)(t - fade_last);
+	uint32_t target = (uint32_t)fade_target << 16;
+	fade_last = t;
+	if (fade_pos < target) {
+		fade_pos = (target - fade_pos > step) ? fade_pos + step : target;
+	} else {
+		fade_pos = (fade_pos - target > step) ? fade_pos - step : target;
+	}
+	if (fade_pos == target)
+		fade_busy = 0;
+	fade_apply(fade_pos >> 16);
+}
+
+#ifdef EXPAND_LUT_RAM
+const uint8_t expand_lut[16] =
+#else
+const uint8_t expand_lut[16] PROGMEM =
+#endif
+{
+	0x00, 0x03, 0x0C, 0x0F, 0x30, 0x33, 0x3C, 0x3F,
+	0xC0, 0xC3, 0xCC, 0xCF, 0xF0, 0xF3, 0xFC, 0xFF
+};
+
+void clear_screen(uint8_t start, uint8_t cols)
+{
+	memset((void *)&framebuf[start], 0, cols << 1);
+#if DISPLAY_BCM_BITS > 1
+	uint8_t k;
+	for(k = 0; k < DISPLAY_BCM_BITS - 1; ++k)
+		memset((void *)&framebuf_lo[k][start], 0, cols << 1);
+#endif
+}
+
+// the column drivers.  with the serial port on, PD0 is RXD, so the rightmost
+// column (col 7) is driven from PB0 instead.
+#ifdef UART
+#define COLUMNS_OFF() do { PORTD = 0; PORTB &= ~(1 << PB0); } while (0)
+#define COLUMN_ON(col) do { \
+	if ((col) < 7) PORTD = (uint8_t)0x80U >> (col); else PORTB |= (1 << PB0); } while (0)
+#else
+#define COLUMNS_OFF() PORTD = 0
+#define COLUMN_ON(col) PORTD = (uint8_t)0x80U >> (col)
+#endif
+
+// the palette, two pixels (a nibble of a framebuf word) at a time
+static uint8_t palette_lut[16];
+static uint8_t palette_on;	// 0 for PALETTE_NORMAL, which doesn't need looking up
+
+void display_palette(uint8_t palette)
+{
+	uint8_t n;
+	for(n = 0; n < 16; ++n)
+		palette_lut[n] = ((palette >> 2 * (n & 3)) & 3) | ((palette >> 2 * (n >> 2)) & 3) << 2;
+	palette_on = (palette != PALETTE_NORMAL);
+	display_update();
+}
+
+static inline uint8_t palette_byte(uint8_t b)
+{
+	return palette_lut[b & 0x0F] | palette_lut[b >> 4] << 4;
+}
+
+#ifdef DISPLAY_MONO
+// a one-color panel has one row bit per pixel, lit if either color is.
+// this takes two pixels (a nibble of a framebuf word) to their two bits.
+static const uint8_t mono_lut[16] PROGMEM =
+{
+	0, 1, 1, 1, 2, 3, 3, 3, 2, 3, 3, 3, 2, 3, 3, 3
+};
+
+#define MONO_BITS(c, n) ((row_word_t)pgm_read_byte(&mono_lut[((c) >> (4 * (n))) & 0x0F]) << (2 * (n)))
+#define ROW_WORD(c) (MONO_BITS(c, 0) | MONO_BITS(c, 1) | MONO_BITS(c, 2) | MONO_BITS(c, 3))
+#else
+#define ROW_WORD(c) (c)
+#endif
+
+// returns nonzero if anything in the plane is lit
+static uint16_t update_plane(volatile row_word_t (*dst)[DISPLAY_PANELS], volatile uint16_t *src)
+{
+	uint8_t i;
+	uint16_t lit = 0;
+	for(i = 0; i < DISPLAY_WIDTH; ++i)
+	{
+		uint16_t c = src[(fb_base + i) & FB_MASK];
+		if (palette_on)
+			c = palette_byte(c) | (uint16_t)palette_byte(c >> 8) << 8;
+		lit |= c;
+		dst[i % PANEL_COLS][DISPLAY_PANELS - 1 - i / PANEL_COLS] = ~ROW_WORD(c);
+	}
+	return lit;
+}
+
+#define TIMER0_CLOCK ((1<<CS01) | (1<<CS00))
+
+void display_update(void)
+{
+	PROF_FN_ENTER();
+	scanout_t back;
+
+	// take back a flip that's still waiting, so the ISR can't swap in a half-built frame
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		flip_pending = 0;
+		back = (scanout_front == scanout[0]) ? scanout[1] : scanout[0];
+	}
+
+	uint16_t lit = update_plane(back[DISPLAY_BCM_BITS - 1], framebuf);
+#if DISPLAY_BCM_BITS > 1
+	uint8_t k;
+	for(k = 0; k < DISPLAY_BCM_BITS - 1; ++k)
+		lit |= update_plane(back[k], framebuf_lo[k]);
+#endif
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if (lit) {
+			// if the refresh is stopped there's no frame to tear, so show it now
+			if (TCCR0B) {
+				flip_pending = 1;
+			} else {
+				scanout_front = back;
+				SCAN_RESTART();
+				// a fade set going while the display was blank starts from now
+				fade_last = TCNT1;
+			}
+			TCCR0B = TIMER0_CLOCK;
+		} else {
+			// no point scanning a blank display
+			scanout_front = back;
+			SCAN_RESTART();
+			TCCR0B = 0;
+			COLUMNS_OFF();
+		}
+	}
+	PROF_FN_EXIT();
+}
+
+void queue_flip(uint8_t base)
+{
+	fb_base = base;
+	display_update();
+}
+
+void wait_vsync(void)
+{
+	while (flip_pending)
+		sched_idle();
+}
+
+// frame boundary: this is the only place the picture can change without tearing.
+// the refresh ISR calls this once it's done the last column.
+#ifdef DISPLAY_ASM
+void display_frame(void);	// called from display_asm.S
+#else
+static inline void display_frame(void);
+#endif
+void display_frame(void)
+{
+	if (flip_pending)
+	{
+		scanout_front = (scanout_front == scanout[0]) ? scanout[1] : scanout[0];
+		flip_pending = 0;
+	}
+	if (fade_busy)
+		fade_step();
+	++display_frames;
+	PROF_FRAME();
+}
+
+#ifndef DISPLAY_ASM
+
+// display interrupt vector
+#define LATCH_0() PORTC &= ~0x04
+#define LATCH_1() PORTC |=  0x04
+
+#ifdef DISPLAY_SPI
+
+// same bit order as the bit-banged version: LSB first, low byte first.
+#define SPI_SEND(b) do { SPDR = (b); while (!(SPSR & (1 << SPIF))); } while (0)
+
+static inline void shift_out(row_word_t c)
+{
+	SPI_SEND((uint8_t)c);
+#if ROW_BITS > 8
+	SPI_SEND((uint8_t)(c >> 8));
+#endif
+}
+
+#else
+
+// one bit per two port writes; no branches, so every column takes the same time.
+// (nothing else touches PORTC outside of here, so we can write the whole port.)
+#define SHIFT_BIT(b) do { d = port | ((b) & 1); PORTC = d; PORTC = d | 0x02; } while (0)
+#define SHIFT_BYTE(b) do { \
+	SHIFT_BIT(b); b >>= 1; SHIFT_BIT(b); b >>= 1; SHIFT_BIT(b); b >>= 1; SHIFT_BIT(b); b >>= 1; \
+	SHIFT_BIT(b); b >>= 1; SHIFT_BIT(b); b >>= 1; SHIFT_BIT(b); b >>= 1; SHIFT_BIT(b); } while (0)
+
+static inline void shift_out(row_word_t c)
+{
+	uint8_t port = PORTC & ~0x03;	// clock and data low
+	uint8_t lo = c, d;
+	SHIFT_BYTE(lo);
+#if ROW_BITS > 8
+	uint8_t hi = c >> 8;
+	SHIFT_BYTE(hi);
+#endif
+	PORTC = port;
+}
+
+#endif
+
+ISR(TIMER0_COMPA_vect)
+{
+	static uint8_t col = 0;
+	PROF_ISR_ENTER();
+#if DISPLAY_BCM_BITS > 1
+	static uint8_t plane = 0;
+
+	// show this bit plane for as long as its weight says
+	OCR0A = bcm_top[plane];
+	OCR0B = fade_top[plane];
+#else
+	const uint8_t plane = 0;
+#endif
+
+	// shift the data for this column to the 595s
+	volatile row_word_t *c = scanout_front[plane][col];
+	uint8_t p;
+	LATCH_0();
+	for(p = 0; p < DISPLAY_PANELS; ++p)
+		shift_out(c[p]);
+
+	// turn off the display
+	COLUMNS_OFF();
+
+	// latch the new value
+	LATCH_1();
+
+	// turn on this column
+	COLUMN_ON(col);
+
+	// next time we'll do the next column (or the next plane of this one)
+#if DISPLAY_BCM_BITS > 1
+	if (++plane < DISPLAY_BCM_BITS) {
+		PROF_REFRESH_EXIT();
+		return;
+	}
+	plane = 0;
+#endif
+	col = (col + 1) & (PANEL_COLS - 1);
+	if (col == 0)
+		display_frame();
+	PROF_REFRESH_EXIT();
+}
+
+// use this to fade the display in/out by turning the column off early
+ISR(TIMER0_COMPB_vect)
+{
+	PROF_ISR_ENTER();
+	COLUMNS_OFF();
+	PROF_ISR_EXIT();
+}
+
+#endif
+
+void display_init(void)
+{
+#ifdef UART
+	DDRB |= (1<<PB0);			// the rightmost column driver
+#endif
+#ifdef DISPLAY_SPI
+	DDRB |= (1<<PB2) | (1<<PB3) | (1<<PB5);	// SS, MOSI, SCK
+	SPCR = (1<<SPE) | (1<<DORD) | (1<<MSTR);	// master, LSB first, mode 0
+	SPSR = (1<<SPI2X);			// fosc/2 = 4MHz
+#endif
+
+	// Setup the display timer...
+	TCCR0A = (1<<WGM01);			// CTC mode
+	TCCR0B = TIMER0_CLOCK;			// 1/64 prescaler; at 8MHz system clock, this counts at 125kHz.
+	OCR0A = REFRESH;
+	SCAN_RESTART();
+	TIMSK0 = (1<<OCIE0A);			// Enable refresh interrupt
+#if DISPLAY_BCM_BITS > 1
+	display_fade(FADE_BRIGHT);
+#endif
+}
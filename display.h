@@ -0,0 +1,165 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <avr/io.h>
+
+#include "config.h"
+
+// Row shift register backends, chosen at build time:
+//
+// default:      bit-banged on PORTC0 (data) / PORTC1 (clock), as the board is wired.
+// DISPLAY_SPI:  clocked out by the SPI peripheral.  Requires moving the row data line
+//               from PORTC0 to PORTB3 (MOSI) and the row clock from PORTC1 to PORTB5 (SCK);
+//               the latch stays on PORTC2.  PORTB2 (SS) is driven as an output so the
+//               SPI stays in master mode, so don't hang anything on it.
+//
+// (the USART's SPI master mode would be nicer still, thanks to its buffered transmitter,
+//  but its TXD/XCK pins are PD1/PD4, which are column drivers.)
+
+// the geometry (DISPLAY_PANELS, DISPLAY_WIDTH, FB_COLS ...) and color depth are in config.h
+
+// DISPLAY_ASM: the refresh and fade ISRs come from display_asm.S instead, as naked handlers
+// that keep their state in registers r2..r5, which the Makefile reserves throughout with
+// -ffixed-r2 etc.  that only covers code we compile: libgcc and avr-libc come prebuilt, so
+// check the linked image with "make check-asm-regs" after changing what the firmware calls.
+// only the plain one-bit-per-pixel display on PORTD is done.
+#ifdef DISPLAY_ASM
+#if DISPLAY_BCM_BITS > 1
+#error "DISPLAY_ASM doesn't do grayscale"
+#endif
+#if defined(UART) || defined(PROFILE)
+#error "DISPLAY_ASM can't be built with UART or PROFILE"
+#endif
+#endif
+
+#ifndef __ASSEMBLER__
+
+// frame buffer - each word stores one column, alternating between green and red.
+// there are DISPLAY_WIDTH visible columns; the leftmost column is drawn from framebuf[fb_base].
+// fb_base can be adjusted between 0 and FB_COLS - 1 to do things like scrolling or page flipping
+// (fb_base ^= DISPLAY_WIDTH flips pages); past the end, the display wraps around to 0.
+extern volatile uint8_t fb_base;
+extern volatile uint16_t framebuf[FB_COLS];
+
+// grayscale: building with -DDISPLAY_BCM_BITS=n (2..4) gives each pixel n bits of intensity
+// per color, shown with binary code modulation: each column is displayed once per bit,
+// for a time proportional to that bit's weight, so n bits cost only n interrupts per column.
+// framebuf holds the top bit of every pixel and framebuf_lo[k] holds bit k.
+// fb_write() sets a column at full intensity in every plane.
+
+#if DISPLAY_BCM_BITS > 1
+extern volatile uint16_t framebuf_lo[DISPLAY_BCM_BITS - 1][FB_COLS];
+#endif
+
+static inline void fb_write(uint8_t n, uint16_t c)
+{
+	framebuf[n] = c;
+#if DISPLAY_BCM_BITS > 1
+	uint8_t k;
+	for(k = 0; k < DISPLAY_BCM_BITS - 1; ++k)
+		framebuf_lo[k][n] = c;
+#endif
+}
+
+// call this after changing fb_base or the visible part of framebuf;
+// the display ISR works from a copy that this refreshes.  the new copy goes up at the
+// next frame boundary (when the scan wraps around to the leftmost column), so a frame
+// never shows half of one picture and half of another; updating again before then
+// just replaces the one that's waiting.
+// when there's nothing lit it stops the refresh timer altogether (which also stops
+// feeding the RNG), so the scheduler can power down; the next update with anything
+// to show starts it again.
+// it isn't reentrant, and the text scroller calls it from its interrupt: while text may
+// be scrolling, scroll_wait() before calling it (or anything that does) from the main loop.
+void display_update(void);
+
+// page flip: shows the page starting at base from the next frame on
+void queue_flip(uint8_t base);
+
+// idle, running tasks, until the last update is on the display.
+// not from an interrupt handler.
+void wait_vsync(void);
+
+// counts up at every frame boundary (about 100Hz; slower when dimmed, stopped when blank)
+extern volatile uint8_t display_frames;
+
+void clear_screen(uint8_t start, uint8_t cols);
+
+// palette: every pixel's 2-bit value (0 = off, 1 = green, 2 = red, 3 = orange, as for
+// COLOR_MASK) is looked up in the palette on its way into the ISR's copy, so recoloring
+// the whole display is one call instead of a rewrite of framebuf.  it takes effect
+// straight away (at the next frame boundary) and stays until it's changed back.
+// with grayscale, it applies to every bit plane alike.  it calls display_update(), so
+// scroll_wait() first if text may be scrolling.
+#define PALETTE(off, green, red, orange) ((off) | (green) << 2 | (red) << 4 | (orange) << 6)
+#define PALETTE_NORMAL PALETTE(0, COLOR_GREEN, COLOR_RED, COLOR_ORANGE)
+#define PALETTE_SWAP   PALETTE(0, COLOR_RED, COLOR_GREEN, COLOR_ORANGE)	// red and green trade places
+#define PALETTE_GREEN  PALETTE(0, COLOR_GREEN, 0, COLOR_GREEN)	// just the green plane
+#define PALETTE_RED    PALETTE(0, 0, COLOR_RED, COLOR_RED)	// just the red plane
+#define PALETTE_BLANK  0			// everything off (for flashing)
+void display_palette(uint8_t palette);
+
+// turn a 1bpp column (bit j = row j) into a framebuf word with both bits of each lit row set.
+// AND the result with COLOR_MASK() to pick the color, or with one plane's mask.
+// the lookup table lives in flash unless built with EXPAND_LUT_RAM, which costs
+// 16 bytes of RAM and saves a cycle per lookup.
+#define COLOR_GREEN 1
+#define COLOR_RED 2
+#define COLOR_ORANGE 3
+#define COLOR_MASK(color) ((uint16_t)(color) * 0x5555)
+#define GREEN_MASK 0x5555
+#define RED_MASK 0xAAAA
+
+#ifdef EXPAND_LUT_RAM
+extern const uint8_t expand_lut[16];
+#define EXPAND_NIBBLE(n) expand_lut[n]
+#else
+#include <avr/pgmspace.h>
+extern const uint8_t expand_lut[16] PROGMEM;
+#define EXPAND_NIBBLE(n) pgm_read_byte(&expand_lut[n])
+#endif
+
+static inline uint16_t expand_column(uint8_t b)
+{
+	return EXPAND_NIBBLE(b & 0x0F) | ((uint16_t)EXPAND_NIBBLE(b >> 4) << 8);
+}
+
+// timer0 runs at 125kHz.  we refresh a column when this value is reached.
+// 125000 / 157 = 796Hz column refresh = just under 100Hz per column
+#define REFRESH 157
+
+// to fade the display, we turn off the display prior to the row refresh.
+#define FADE_DARK 1
+#define FADE_BRIGHT (REFRESH - 1)
+// each bit plane is shown for a different time, so the cutoff is scaled for each.
+// without grayscale, a dim display is refreshed more slowly too (same brightness,
+// fewer interrupts); FADE_OFF() puts the rate back.
+void display_fade(uint8_t level);
+#define FADE_LEVEL(x) display_fade(x)
+#define FADE_ON()  TIMSK0 |= (1<<OCIE0B)
+#if DISPLAY_BCM_BITS > 1
+#define FADE_OFF()  TIMSK0 &= ~(1<<OCIE0B)
+#else
+#define FADE_OFF()  do { TIMSK0 &= ~(1<<OCIE0B); OCR0A = REFRESH; } while (0)
+#endif
+
+// the fade engine does that for you from the refresh ISR, once a frame: brightness goes
+// from 0 (FADE_DARK) to FADE_MAX (full, with the cutoff off), through a gamma table so
+// equal steps look equal.  fade_to() sets it going and returns straight away; the fade
+// is timed by timer1, so it takes the same time however busy the main loop is.
+// (a blank display has no frames: a fade started while it's blank waits for something to
+// be drawn, and fading() finishes one that's still going when the display goes blank.)
+#define FADE_MAX 255
+
+// fade from wherever it is now to level over kiloclocks (0 for at once)
+void fade_to(uint8_t level, uint16_t kiloclocks);
+
+// true until the last fade_to() has got there
+uint8_t fading(void);
+
+// sets up the row shift register port and starts the refresh timer
+void display_init(void);
+
+#endif
+
+#endif
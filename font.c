@@ -1,619 +1,149 @@
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
 #include "font.h"
+#include "display.h"
+#include "buttons.h"
+#include "messages.h"
+#include "profile.h"
+#include "persist.h"
 #include <string.h>
 
-const uint8_t alphabet[] PROGMEM =
-{
-  0b00000000,
-  0b00000000,
-  0b00000000,
-  0b00000000,
-  0b00000000,
-  0b00000000,
-  0b00000000,
-  0b00000000,
-  0b01011111,
-  0b00000000,
-  0b00000000,
-  0b00000000,
-  0b00000000,
-  0b00000111,
-  0b00000000,
-  0b00000111,
-  0b00000000,
-  0b00000000,
-  0b00101000,
-  0b01111100,
-  0b00101000,
-  0b01111100,
-  0b00101000,
-  0b00000000,
-  0b00000100,
-  0b00101010,
-  0b01111111,
-  0b00101010,
-  0b00010000,
-  0b00000000,
-  0b00100010,
-  0b00010000,
-  0b00001000,
-  0b00000100,
-  0b00100010,
-  0b00000000,
-  0b00110000,
-  0b01001010,
-  0b01001101,
-  0b00110010,
-  0b01001000,
-  0b00000000,
-  0b00000000,
-  0b00001011,
-  0b00000111,
-  0b00000000,
-  0b00000000,
-  0b00000000,
-  0b00000000,
-  0b00011000,
-  0b00100100,
-  0b01000010,
-  0b00000000,
-  0b00000000,
-  0b00000000,
-  0b01000010,
-  0b00100100,
-  0b00011000,
-  0b00000000,
-  0b00000000,
-  0b00101010,
-  0b00011100,
-  0b01111111,
-  0b00011100,
-  0b00101010,
-  0b00000000,
-  0b00001000,
-  0b00001000,
-  0b00111110,
-  0b00001000,
-  0b00001000,
-  0b00000000,
-  0b00000000,
-  0b10110000,
-  0b01110000,
-  0b00000000,
-  0b00000000,
-  0b00000000,
-  0b00001000,
-  0b00001000,
-  0b00001000,
-  0b00001000,
-  0b00001000,
-  0b00000000,
-  0b00000000,
-  0b01100000,
-  0b01100000,
-  0b00000000,
-  0b00000000,
-  0b00000000,
-  0b00100000,
-  0b00010000,
-  0b00001000,
-  0b00000100,
-  0b00000010,
-  0b00000000,
-  0b00111110,
-  0b01010001,
-  0b01001001,
-  0b01000101,
-  0b00111110,
-  0b00000000,
-  0b00000000,
-  0b01000010,
-  0b01111111,
-  0b01000000,
-  0b00000000,
-  0b00000000,
-  0b01100010,
-  0b01010001,
-  0b01001001,
-  0b01001001,
-  0b01000110,
-  0b00000000,
-  0b00100010,
-  0b01000001,
-  0b01001001,
-  0b01001001,
-  0b00110110,
-  0b00000000,
-  0b00001111,
-  0b00001000,
-  0b00001000,
-  0b01111111,
-  0b00001000,
-  0b00000000,
-  0b00101111,
-  0b01001001,
-  0b01001001,
-  0b01001001,
-  0b00110001,
-  0b00000000,
-  0b00111100,
-  0b01001010,
-  0b01001001,
-  0b01001001,
-  0b00110000,
-  0b00000000,
-  0b00000001,
-  0b01110001,
-  0b00001001,
-  0b00000101,
-  0b00000011,
-  0b00000000,
-  0b00110110,
-  0b01001001,
-  0b01001001,
-  0b01001001,
-  0b00110110,
-  0b00000000,
-  0b00000110,
-  0b01001001,
-  0b01001001,
-  0b00101001,
-  0b00011110,
-  0b00000000,
-  0b00000000,
-  0b00110110,
-  0b00110110,
-  0b00000000,
-  0b00000000,
-  0b00000000,
-  0b00000000,
-  0b10110110,
-  0b01110110,
-  0b00000000,
-  0b00000000,
-  0b00000000,
-  0b00001000,
-  0b00010100,
-  0b00100010,
-  0b01000001,
-  0b00000000,
-  0b00000000,
-  0b00100100,
-  0b00100100,
-  0b00100100,
-  0b00100100,
-  0b00100100,
-  0b00000000,
-  0b00000000,
-  0b01000001,
-  0b00100010,
-  0b00010100,
-  0b00001000,
-  0b00000000,
-  0b00000010,
-  0b00000001,
-  0b01011001,
-  0b00001001,
-  0b00000110,
-  0b00000000,
-  0b00111110,
-  0b01000001,
-  0b01011101,
-  0b01010001,
-  0b00001110,
-  0b00000000,
-  0b01111110,
-  0b00001001,
-  0b00001001,
-  0b00001001,
-  0b01111110,
-  0b00000000,
-  0b01111111,
-  0b01001001,
-  0b01001001,
-  0b01001001,
-  0b00110110,
-  0b00000000,
-  0b00111110,
-  0b01000001,
-  0b01000001,
-  0b01000001,
-  0b00100010,
-  0b00000000,
-  0b01111111,
-  0b01000001,
-  0b01000001,
-  0b00100010,
-  0b00011100,
-  0b00000000,
-  0b01111111,
-  0b01001001,
-  0b01001001,
-  0b01001001,
-  0b01000001,
-  0b00000000,
-  0b01111111,
-  0b00001001,
-  0b00001001,
-  0b00001001,
-  0b00000001,
-  0b00000000,
-  0b00111110,
-  0b01000001,
-  0b01000001,
-  0b01001001,
-  0b01111010,
-  0b00000000,
-  0b01111111,
-  0b00001000,
-  0b00001000,
-  0b00001000,
-  0b01111111,
-  0b00000000,
-  0b00000000,
-  0b01000001,
-  0b01111111,
-  0b01000001,
-  0b00000000,
-  0b00000000,
-  0b00110000,
-  0b01000000,
-  0b01000000,
-  0b01000000,
-  0b00111111,
-  0b00000000,
-  0b01111111,
-  0b00001000,
-  0b00010100,
-  0b00100010,
-  0b01000001,
-  0b00000000,
-  0b01111111,
-  0b01000000,
-  0b01000000,
-  0b01000000,
-  0b01000000,
-  0b00000000,
-  0b01111111,
-  0b00000110,
-  0b00001100,
-  0b00000110,
-  0b01111111,
-  0b00000000,
-  0b01111111,
-  0b00000010,
-  0b00000100,
-  0b00001000,
-  0b01111111,
-  0b00000000,
-  0b00111110,
-  0b01000001,
-  0b01000001,
-  0b01000001,
-  0b00111110,
-  0b00000000,
-  0b01111111,
-  0b00001001,
-  0b00001001,
-  0b00001001,
-  0b00000110,
-  0b00000000,
-  0b00111110,
-  0b01000001,
-  0b01010001,
-  0b00100001,
-  0b01011110,
-  0b00000000,
-  0b01111111,
-  0b00001001,
-  0b00011001,
-  0b00101001,
-  0b01000110,
-  0b00000000,
-  0b00100110,
-  0b01001001,
-  0b01001001,
-  0b01001001,
-  0b00110010,
-  0b00000000,
-  0b00000001,
-  0b00000001,
-  0b01111111,
-  0b00000001,
-  0b00000001,
-  0b00000000,
-  0b00111111,
-  0b01000000,
-  0b01000000,
-  0b01000000,
-  0b00111111,
-  0b00000000,
-  0b00000111,
-  0b00011000,
-  0b01100000,
-  0b00011000,
-  0b00000111,
-  0b00000000,
-  0b01111111,
-  0b00110000,
-  0b00011000,
-  0b00110000,
-  0b01111111,
-  0b00000000,
-  0b01100011,
-  0b00010100,
-  0b00001000,
-  0b00010100,
-  0b01100011,
-  0b00000000,
-  0b00000111,
-  0b00001000,
-  0b01110000,
-  0b00001000,
-  0b00000111,
-  0b00000000,
-  0b01100001,
-  0b01010001,
-  0b01001001,
-  0b01000101,
-  0b01000011,
-  0b00000000,
-  0b00000000,
-  0b01111111,
-  0b01000001,
-  0b01000001,
-  0b00000000,
-  0b00000000,
-  0b00000010,
-  0b00000100,
-  0b00001000,
-  0b00010000,
-  0b00100000,
-  0b00000000,
-  0b00000000,
-  0b01000001,
-  0b01000001,
-  0b01111111,
-  0b00000000,
-  0b00000000,
-  0b00000100,
-  0b00000010,
-  0b00000001,
-  0b00000010,
-  0b00000100,
-  0b00000000,
-  0b01000000,
-  0b01000000,
-  0b01000000,
-  0b01000000,
-  0b01000000,
-  0b00000000,
-  0b00000000,
-  0b00000011,
-  0b00000100,
-  0b00000000,
-  0b00000000,
-  0b00000000,
-  0b00100000,
-  0b01010100,
-  0b01010100,
-  0b01010100,
-  0b01111000,
-  0b00000000,
-  0b01111111,
-  0b01001000,
-  0b01000100,
-  0b01000100,
-  0b00111000,
-  0b00000000,
-  0b00111000,
-  0b01000100,
-  0b01000100,
-  0b01000100,
-  0b01001000,
-  0b00000000,
-  0b00111000,
-  0b01000100,
-  0b01000100,
-  0b01000100,
-  0b01111111,
-  0b00000000,
-  0b00111000,
-  0b01010100,
-  0b01010100,
-  0b01010100,
-  0b00011000,
-  0b00000000,
-  0b00001000,
-  0b01111110,
-  0b00001001,
-  0b00000001,
-  0b00000010,
-  0b00000000,
-  0b00011000,
-  0b10100100,
-  0b10100100,
-  0b10100100,
-  0b01111100,
-  0b00000000,
-  0b01111111,
-  0b00001000,
-  0b00000100,
-  0b00000100,
-  0b01111000,
-  0b00000000,
-  0b00000000,
-  0b01000100,
-  0b01111101,
-  0b01000000,
-  0b00000000,
-  0b00000000,
-  0b01000000,
-  0b10000000,
-  0b10000100,
-  0b01111101,
-  0b00000000,
-  0b00000000,
-  0b01111111,
-  0b00010000,
-  0b00101000,
-  0b01000100,
-  0b00000000,
-  0b00000000,
-  0b00000000,
-  0b01000001,
-  0b01111111,
-  0b01000000,
-  0b00000000,
-  0b00000000,
-  0b01111100,
-  0b00000100,
-  0b01111000,
-  0b00000100,
-  0b01111000,
-  0b00000000,
-  0b01111100,
-  0b00000100,
-  0b00000100,
-  0b00000100,
-  0b01111000,
-  0b00000000,
-  0b00111000,
-  0b01000100,
-  0b01000100,
-  0b01000100,
-  0b00111000,
-  0b00000000,
-  0b11111100,
-  0b00100100,
-  0b00100100,
-  0b00100100,
-  0b00011000,
-  0b00000000,
-  0b00011000,
-  0b00100100,
-  0b00100100,
-  0b00100100,
-  0b11111100,
-  0b00000000,
-  0b01111100,
-  0b00001000,
-  0b00000100,
-  0b00000100,
-  0b00001000,
-  0b00000000,
-  0b00001000,
-  0b01010100,
-  0b01010100,
-  0b01010100,
-  0b00100000,
-  0b00000000,
-  0b00000100,
-  0b00111110,
-  0b01000100,
-  0b01000100,
-  0b00000000,
-  0b00000000,
-  0b00111100,
-  0b01000000,
-  0b01000000,
-  0b01000000,
-  0b00111100,
-  0b00000000,
-  0b00011100,
-  0b00100000,
-  0b01000000,
-  0b00100000,
-  0b00011100,
-  0b00000000,
-  0b00111100,
-  0b01000000,
-  0b00111000,
-  0b01000000,
-  0b00111100,
-  0b00000000,
-  0b01000100,
-  0b00101000,
-  0b00010000,
-  0b00101000,
-  0b01000100,
-  0b00000000,
-  0b10011100,
-  0b10100000,
-  0b10100000,
-  0b10100000,
-  0b01111100,
-  0b00000000,
-  0b01000100,
-  0b01100100,
-  0b01010100,
-  0b01001100,
-  0b01000100,
-  0b00000000,
-  0b00001000,
-  0b00110110,
-  0b01000001,
-  0b01000001,
-  0b00000000,
-  0b00000000,
-  0b00000000,
-  0b00000000,
-  0b01111111,
-  0b00000000,
-  0b00000000,
-  0b00000000,
-  0b00000000,
-  0b01000001,
-  0b01000001,
-  0b00110110,
-  0b00001000,
-  0b00000000,
-  0b00000100,
-  0b00000010,
-  0b00000100,
-  0b00001000,
-  0b00000100,
-  0b00000000
-};
-
-extern void Sleep(uint16_t kiloclocks);
-extern volatile uint8_t fb_base;
-extern volatile uint16_t framebuf[16];
+volatile uint16_t delay = MILLIS(40);
 
-#define BUTTON_LEFT  0x01
-#define BUTTON_RIGHT 0x02
-#define BUTTON_HOLD  0x10 	// button was held
+// columns that have been rendered but not scrolled in yet.  the foreground decodes
+// glyphs into this ring as fast as it has room, and the timer1 compare B interrupt
+// takes one off every delay kiloclocks, so the cadence doesn't depend on how long a
+// character takes to look up.
+#define SCROLL_AHEAD 8
 
-uint8_t GetButtons(void);
+static uint16_t ahead[SCROLL_AHEAD];
+static volatile uint8_t ahead_head, ahead_tail;
+static volatile uint8_t scrolling;
 
-volatile uint16_t delay = MILLIS(40);
+// interrupts stay on, so the refresh isn't held up by display_update()
+ISR(TIMER1_COMPB_vect, ISR_NOBLOCK)
+{
+	uint8_t t = ahead_tail;
+	PROF_PIN_ISR();
+	if (t == ahead_head) {
+		// ran dry; the next column starts things up again
+		TIMSK1 &= ~(1 << OCIE1B);
+		scrolling = 0;
+		PROF_PIN_ISR();
+		return;
+	}
+	fb_write((fb_base + DISPLAY_WIDTH) & FB_MASK, ahead[t]);
+	ahead_tail = (t + 1) & (SCROLL_AHEAD - 1);
+	fb_base = (fb_base + 1) & FB_MASK;
+	display_update();
+	// the refresh ISR can come in here and read TCNT1 through the shared TEMP register
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		OCR1B += delay;
+	}
+	PROF_PIN_ISR();
+}
 
-void scroll_char(char c, uint8_t color)
+static void scroll_column(uint16_t col)
 {
-	uint8_t buttons;
-	uint16_t base = ((uint16_t)c - 32) * 6;
-	for(uint8_t i = 0; i < 6; ++i)
+	uint8_t h = ahead_head, buttons;
+	while (((h + 1) & (SCROLL_AHEAD - 1)) == ahead_tail)
+		sched_idle();
+	ahead[h] = col;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
 	{
-		uint8_t b = pgm_read_byte_near(alphabet + base + i);
-		uint8_t n = (fb_base + 8) & 0x0F;
-		uint16_t c = 0;
-		uint8_t j;
-		for(j = 0x80; j != 0; j >>= 1)
-		{
-			c <<= 2;
-			if (b & j)
-				c |= color;
+		ahead_head = (h + 1) & (SCROLL_AHEAD - 1);
+		if (!scrolling) {
+			scrolling = 1;
+			OCR1B = TCNT1 + 1;
+			TIFR1 = (1 << OCF1B);
+			TIMSK1 |= (1 << OCIE1B);
 		}
-		framebuf[n] = c;
-		fb_base = (fb_base + 1) & 0x0F;
-		Sleep(delay);
-		buttons = GetButtons();
+	}
+
+	buttons = GetButtons();
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
 		if ((buttons & BUTTON_LEFT) && (delay < MILLIS(200)))
 			delay += MILLIS(8);
 		else if ((buttons & BUTTON_RIGHT) && (delay > MILLIS(10)))
 			delay -= MILLIS(8);
 	}
+	if (buttons & (BUTTON_LEFT | BUTTON_RIGHT))
+		persist_save();
+}
+
+// the last character scrolled in, for kerning; 0 at the start of a line
+static uint8_t prev_char;
+
+void scroll_wait(void)
+{
+	while (scrolling)
+		sched_idle();
+	prev_char = 0;
+}
+
+#if FONT_PROPORTIONAL
+
+#define FONT_WIDTH(g) ((pgm_read_byte_near(font_width + (g) / 2) >> (((g) & 1) * 4)) & 15)
+
+// true if b goes right up against a, without the usual blank column
+static uint8_t kerned(uint8_t a, uint8_t b)
+{
+	const char *k;
+	for(k = font_kern[0]; k < font_kern[FONT_KERNS]; k += 2)
+	{
+		uint8_t l = pgm_read_byte_near(k);
+		if (l > a)
+			break;
+		if (l == a && pgm_read_byte_near(k + 1) == b)
+			return 1;
+	}
+	return 0;
+}
+
+void scroll_char(char c, uint8_t color)
+{
+	uint8_t g = (uint8_t)c - FONT_FIRST, i, w;
+	uint16_t mask = COLOR_MASK(color);
+	const uint8_t *p;
+
+	// the offset table only has every FONT_BLOCKth glyph; add up the widths since then
+	uint16_t base = pgm_read_word_near(font_block + g / FONT_BLOCK);
+	for(i = g & ~(FONT_BLOCK - 1); i < g; ++i)
+		base += FONT_WIDTH(i);
+	w = FONT_WIDTH(g);
+
+	if (prev_char && !kerned(prev_char, c))
+		scroll_column(0);
+	prev_char = c;
+	for(p = font_data + base; w; --w)
+		scroll_column(expand_column(pgm_read_byte_near(p++)) & mask);
+}
+
+#elif FONT_FIXED
+
+void scroll_char(char c, uint8_t color)
+{
+	const uint8_t *p = font_data + ((uint8_t)c - FONT_FIRST) * FONT_CELL;
+	uint16_t mask = COLOR_MASK(color);
+	for(uint8_t i = 0; i < FONT_CELL; ++i)
+		scroll_column(expand_column(pgm_read_byte_near(p + i)) & mask);
+}
+
+#else	// FONT_EXPANDED
+
+void scroll_char(char c, uint8_t color)
+{
+	const uint16_t *p = font_data + ((uint8_t)c - FONT_FIRST) * FONT_CELL;
+	uint16_t mask = COLOR_MASK(color);
+	for(uint8_t i = 0; i < FONT_CELL; ++i)
+		scroll_column(pgm_read_word_near(p + i) & mask);
 }
 
+#endif
+
 void DrawTextP(const char *text, uint8_t color)
 {
 	int i = 0;
@@ -627,9 +157,17 @@ void DrawTextP(const char *text, uint8_t color)
 	}
 }
 
+void DrawMessage(uint16_t n, uint8_t color)
+{
+	struct msg_reader r;
+	uint8_t c;
+	msg_open(&r, n);
+	while ((c = msg_getc(&r)) != 0)
+		scroll_char((char)c, color);
+}
+
 void DrawText(const char *text, uint8_t color)
 {
 	while(*text)
 		scroll_char(*text++, color);
 }
-
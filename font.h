@@ -3,19 +3,36 @@
 
 #include <avr/pgmspace.h>
 
-// convert milliseconds to "kiloclocks" for Sleep(), assuming 8MHz system clock
-// intended for literals; let the compiler do the floating-point math, not the poor AVR ;)
-#define MILLIS(x) ((uint16_t)(7.812 * (x)))
+#include "sched.h"
+#include "assets.h"	// generated from font.bmp by tools/assetgen
+
+// the font comes in one of three layouts (FONT_LAYOUT in the Makefile):
+// FONT_PROPORTIONAL: glyph g (character FONT_FIRST + g) is FONT_WIDTH(g) columns
+//   of font_data, bit 0 at the top; font_width packs the widths two to a byte, low nibble
+//   first, and font_block has the offset of every FONT_BLOCKth glyph.  pairs listed in
+//   font_kern (sorted) are drawn without the blank column in between.
+// FONT_FIXED: FONT_CELL bytes of font_data per glyph, blank column included.
+// FONT_EXPANDED: the same, but as framebuf words ready to be masked with a color.
 
 extern volatile uint16_t delay;
 
+// Scrolls one character in from the right
+void scroll_char(char c, uint8_t color);
+
 // Scrolls the specified text in the specified color,
-// delaying for the specified number of kiloclocks between pixels.
-// Starts by scrolling the existing frame data to the left,
-// and ends when the last character is on the right,
-// so you can issue another call to change attributes.
+// delaying for delay kiloclocks between pixels.
+// Starts by scrolling the existing frame data to the left.
+// the text is rendered a few columns ahead and scrolled in by timer1, so these
+// return while the end of it is still on its way; another call (say, to change
+// attributes) just carries on from there without a hitch.
 void DrawTextP(const char *text, uint8_t color);
 void DrawText(const char *text, uint8_t color);
 
+// same, for message n from the compressed message store (see messages.h)
+void DrawMessage(uint16_t n, uint8_t color);
+
+// wait for everything to finish scrolling in, before drawing on the display some other way
+void scroll_wait(void);
+
 #endif
 
@@ -0,0 +1,330 @@
+// Conway's Game of Life on a LIFE_COLS x LIFE_ROWS torus
+//
+// each column is a life_col_t, so one pass of bitwise logic handles all the cells in it:
+// the neighbor count is done with full adders on whole words instead of cell by cell.
+
+#include <stdint.h>
+#include <string.h>
+#include <util/crc16.h>
+
+#include "life.h"
+#include "display.h"
+#include "rng.h"
+#include "profile.h"
+#include "sched.h"
+
+life_col_t life_green[LIFE_COLS];
+life_col_t life_red[LIFE_COLS];
+uint8_t life_view_x, life_view_y;
+
+// hashes of the last LIFE_HISTORY generations' live cells (colors don't matter),
+// so a board that comes back around is noticed on the first repeat.
+// 0 marks an empty slot; a real hash of 0 just goes unrecognized.
+static uint16_t history[LIFE_HISTORY];
+static uint8_t history_pos;
+
+// the board's hash is the xor of a hash of each column (and its position), so
+// life() only has to rehash the columns that changed.
+static uint16_t board_hash;
+
+// columns whose cells changed in the last generation, one bit each.  a column with
+// no dirty neighbors can't change, so life() leaves it (and its sums) alone.
+static uint8_t dirty[(LIFE_COLS + 7) / 8];
+
+#define IS_DIRTY(i) (dirty[(i) >> 3] & (1 << ((i) & 7)))
+
+static uint16_t column_hash(uint8_t i, life_col_t a)
+{
+	uint8_t j;
+	uint16_t h = _crc_ccitt_update(0xffff, i);
+	for(j = 0; j < sizeof(life_col_t); ++j) {
+		h = _crc_ccitt_update(h, (uint8_t)a);
+		a >>= 8;
+	}
+	return h;
+}
+
+void life_reset_history(void)
+{
+	uint8_t i;
+	memset(history, 0, sizeof(history));
+	history_pos = 0;
+	memset(dirty, 0xff, sizeof(dirty));
+	board_hash = 0;
+	for(i = 0; i < LIFE_COLS; ++i)
+		board_hash ^= column_hash(i, life_green[i] | life_red[i]);
+}
+
+// returns 1 if the hash has been seen recently; either way remembers it
+static uint8_t seen_before(uint16_t h)
+{
+	uint8_t i, seen = 0;
+	for(i = 0; i < LIFE_HISTORY; ++i)
+	{
+		if (history[i] == h)
+			seen = 1;
+	}
+	history[history_pos] = h;
+	if (++history_pos == LIFE_HISTORY)
+		history_pos = 0;
+	return seen;
+}
+
+#define ROL(x) ((life_col_t)(((x) << 1) | ((x) >> (LIFE_ROWS - 1))))
+#define ROR(x) ((life_col_t)(((x) >> 1) | ((x) << (LIFE_ROWS - 1))))
+
+// merge a column's two color planes into the framebuf layout
+static uint16_t render_column(uint8_t g, uint8_t r)
+{
+	return (expand_column(g) & GREEN_MASK) | (expand_column(r) & RED_MASK);
+}
+
+#if DISPLAY_BCM_BITS > 1
+
+// with grayscale, cells dim as they age
+#define LEVEL_MAX ((1 << DISPLAY_BCM_BITS) - 1)
+#define LEVEL_GREEN LEVEL_MAX
+#define LEVEL_ORANGE (LEVEL_MAX - LEVEL_MAX / 3)
+#define LEVEL_RED (LEVEL_MAX / 3)
+
+// the cells of a column that are lit in bit plane k
+#define PLANE_CELLS(k, green, orange, red) \
+	(((LEVEL_GREEN >> (k)) & 1 ? (green) : 0) | \
+	 ((LEVEL_ORANGE >> (k)) & 1 ? (orange) : 0) | \
+	 ((LEVEL_RED >> (k)) & 1 ? (red) : 0))
+
+static void draw_column(uint8_t n, uint8_t g, uint8_t r)
+{
+	uint8_t green = g & ~r, orange = g & r, red = r & ~g, k;
+	for(k = 0; k < DISPLAY_BCM_BITS - 1; ++k)
+	{
+		uint8_t m = PLANE_CELLS(k, green, orange, red);
+		framebuf_lo[k][n] = render_column(g & m, r & m);
+	}
+	uint8_t m = PLANE_CELLS(DISPLAY_BCM_BITS - 1, green, orange, red);
+	framebuf[n] = render_column(g & m, r & m);
+}
+
+#else
+
+static void draw_column(uint8_t n, uint8_t g, uint8_t r)
+{
+	framebuf[n] = render_column(g, r);
+}
+
+#endif
+
+// the 8 rows of a column that are in the viewport
+static uint8_t view_rows(life_col_t c)
+{
+#if LIFE_ROWS > PANEL_ROWS
+	uint8_t y = life_view_y;
+	if (y)
+		c = (c >> y) | (c << (LIFE_ROWS - y));
+#endif
+	return (uint8_t)c;
+}
+
+// the world wraps around, so a display wider than it just shows it more than once
+void life_render(uint8_t dst)
+{
+	uint8_t i;
+	for(i = 0; i < DISPLAY_WIDTH; ++i)
+	{
+		uint8_t x = (life_view_x + i) & (LIFE_COLS - 1);
+		draw_column(dst + i, view_rows(life_green[x]), view_rows(life_red[x]));
+	}
+}
+
+void life_pan(int8_t dx, int8_t dy)
+{
+	life_view_x = (life_view_x + dx) & (LIFE_COLS - 1);
+	life_view_y = (life_view_y + dy) & (LIFE_ROWS - 1);
+}
+
+// the board that comes from a given seed, so a good one can be had again
+// from just the seed (a xorshift of its own, since rand8() adds fresh noise)
+static void seed_board(uint32_t x)
+{
+	uint8_t i, j;
+	if (x == 0)
+		x = 1;
+	for(i = 0; i < LIFE_COLS; ++i) {
+		life_col_t c = 0;
+		for(j = 0; j < sizeof(life_col_t); ++j) {
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			c = (c << 8) | (uint8_t)(x >> 24);
+		}
+		life_red[i] = c;
+		life_green[i] = 0;
+	}
+	life_reset_history();
+}
+
+static uint32_t rand32(void)
+{
+	uint8_t i;
+	uint32_t x = 0;
+	for(i = 0; i < 4; ++i)
+		x = (x << 8) | rand8();
+	return x;
+}
+
+// the pre-roll: the seed on trial and how many generations it's stayed active,
+// and whether it made it
+#define LIFE_PREROLL_TICK MILLIS(20)
+static uint32_t preroll_seed;
+static uint16_t preroll_gens;
+static uint8_t preroll_found;
+
+static void preroll_step(void)
+{
+	if (preroll_gens == 0) {
+		preroll_seed = rand32();
+		seed_board(preroll_seed);
+	}
+	if (life_step() != ACTIVE) {
+		preroll_gens = 0;	// next!
+	} else if (++preroll_gens == LIFE_PREROLL) {
+		preroll_found = 1;
+		sched_cancel(preroll_step);
+	}
+}
+
+void life_preroll(void)
+{
+	preroll_gens = preroll_found = 0;
+	sched_at(preroll_step, now() + LIFE_PREROLL_TICK, LIFE_PREROLL_TICK);
+}
+
+void life_seed(void)
+{
+	sched_cancel(preroll_step);
+	seed_board(preroll_found ? preroll_seed : rand32());
+	preroll_found = 0;
+}
+
+// vertical sums (cell above + cell + cell below) for column i, as two bit planes
+static inline void column_sum(uint8_t i, life_col_t *s0, life_col_t *s1)
+{
+	life_col_t a = life_green[i] | life_red[i];
+	life_col_t u = ROL(a), d = ROR(a), x = u ^ a;
+	*s0 = x ^ d;
+	*s1 = (u & a) | (x & d);
+}
+
+uint8_t life_step(void)
+{
+	// the column sums to the left, here and to the right.  the columns are updated
+	// in place, so these are always computed before their column changes, and
+	// column 0's original sums are kept for when the last column wraps around to it.
+	// sums are only worked out when a column that needs them comes along; a skipped
+	// column hasn't changed, so its sums can still be taken later.
+	life_col_t l0 = 0, l1 = 0, c0 = 0, c1 = 0, r0, r1, first0 = 0, first1 = 0;
+	uint8_t have_l = 0, have_c = 0, have_first = 0;
+	uint8_t i, ret = DEAD, colstate;
+#ifdef PROFILE
+	uint16_t prof_start = now();
+#endif
+	PROF_FN_ENTER();
+
+	// dirty bits from the last generation for columns i-1, i and i+1.
+	// column 0's is kept, since it's overwritten before the last column needs it.
+	uint8_t first_dirty = IS_DIRTY(0);
+	uint8_t was_l = IS_DIRTY(LIFE_COLS - 1), was_c = first_dirty, was_r;
+
+	for(i = 0; i < LIFE_COLS; ++i)
+	{
+		life_col_t g = life_green[i], r = life_red[i], a = g | r;
+		uint8_t *d = &dirty[i >> 3], bit = 1 << (i & 7);
+
+		was_r = (i + 1 < LIFE_COLS) ? IS_DIRTY(i + 1) : first_dirty;
+		if (!(was_l | was_c | was_r))
+		{
+			colstate = a ? STEADY : DEAD;
+			*d &= ~bit;
+			l0 = c0; l1 = c1;
+			have_l = have_c;
+			have_c = 0;
+		}
+		else
+		{
+			if (!have_l)
+				column_sum((i - 1) & (LIFE_COLS - 1), &l0, &l1);
+			if (!have_c)
+				column_sum(i, &c0, &c1);
+			if (i == 0) {
+				first0 = c0;
+				first1 = c1;
+				have_first = 1;
+			}
+			if (i + 1 < LIFE_COLS || !have_first) {
+				column_sum((i + 1) & (LIFE_COLS - 1), &r0, &r1);
+			} else {
+				r0 = first0;
+				r1 = first1;
+			}
+
+			// add up the three column sums.  this counts the cell itself, so the
+			// total is 0..9; keeping three bits of it is enough to tell 3 and 4 apart
+			// from everything else.
+			life_col_t s0 = l0 ^ c0;
+			life_col_t k = l0 & c0;
+			life_col_t x1 = l1 ^ c1;
+			life_col_t s1 = x1 ^ k;
+			life_col_t s2 = (l1 & c1) | (x1 & k);
+
+			life_col_t t0 = s0 ^ r0;
+			life_col_t k0 = s0 & r0;
+			life_col_t y1 = s1 ^ r1;
+			life_col_t t1 = y1 ^ k0;
+			life_col_t t2 = s2 ^ ((s1 & r1) | (y1 & k0));
+
+			// total of 3: born, or survived with 2 neighbors.
+			// total of 4: survived with 3 neighbors (a dead cell with 4 stays dead).
+			life_col_t next = (~t2 & t1 & t0) | (t2 & ~t1 & ~t0 & a);
+			life_col_t survived = next & a;
+
+			life_green[i] = (next & ~a) | (survived & g & ~r);	// born, or green going orange
+			life_red[i] = survived;
+
+			if (life_green[i] == g && life_red[i] == r) {
+				colstate = next ? STEADY : DEAD;
+				*d &= ~bit;
+			} else {
+				colstate = ACTIVE;
+				*d |= bit;
+				if (next != a)
+					board_hash ^= column_hash(i, a) ^ column_hash(i, next);
+			}
+
+			l0 = c0; l1 = c1;
+			c0 = r0; c1 = r1;
+			have_l = have_c = 1;
+		}
+		if (colstate > ret)
+			ret = colstate;
+		was_l = was_c;
+		was_c = was_r;
+	}
+
+	// spinners and other oscillators are teh boring.
+	if (seen_before(board_hash) && ret == ACTIVE)
+		ret = PERIODIC;
+
+	PROF_FN_EXIT();
+#ifdef PROFILE
+	prof.life_kc += (uint16_t)(now() - prof_start);
+	++prof.life_calls;
+#endif
+	return ret;
+}
+
+uint8_t life(uint8_t dst)
+{
+	uint8_t ret = life_step();
+	life_render(dst);
+	return ret;
+}
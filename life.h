@@ -0,0 +1,72 @@
+#ifndef LIFE_H
+#define LIFE_H
+
+#include <stdint.h>
+
+#include "config.h"
+
+// the world is a LIFE_COLS x LIFE_ROWS torus (sized in config.h), bigger than the display,
+// so patterns have room to grow and gliders get somewhere before they wrap around.
+// the display shows a viewport onto it, starting at (life_view_x, life_view_y).
+
+#if LIFE_ROWS == 8
+typedef uint8_t life_col_t;
+#elif LIFE_ROWS == 16
+typedef uint16_t life_col_t;
+#elif LIFE_ROWS == 32
+typedef uint32_t life_col_t;
+#else
+#error "LIFE_ROWS must be 8, 16 or 32"
+#endif
+
+// the gameboard, one life_col_t per column; bit j is row j.
+// a live cell is green when it was just born, orange (both planes)
+// after surviving one generation and red ("mature") after that.
+extern life_col_t life_green[LIFE_COLS];
+extern life_col_t life_red[LIFE_COLS];
+
+extern uint8_t life_view_x, life_view_y;
+
+// how many past generations life() remembers, to spot oscillators
+#define LIFE_HISTORY 8
+
+// how many generations a board gets before we decide it's been running long enough:
+// roughly enough for a glider to cross the world, rather less on the bare 8x8 display
+#define LIFE_PATIENCE ((LIFE_COLS + LIFE_ROWS) * 2 > 35 ? (LIFE_COLS + LIFE_ROWS) * 2 : 35)
+
+// compute the next generation in place and draw the viewport into
+// framebuf[dst..dst+DISPLAY_WIDTH-1].  returns the state of the cells:
+#define DEAD 0
+#define STEADY 1	// nothing changed
+#define PERIODIC 2	// repeats one of the last LIFE_HISTORY generations
+#define ACTIVE 3
+uint8_t life(uint8_t dst);
+
+// the same, without drawing anything
+uint8_t life_step(void);
+
+// fill the world randomly with red ("mature") cells, and forget the old one's history.
+// if life_preroll() has found a board since it was started, that's the one.
+void life_seed(void);
+
+// many random boards die out or settle down within a few generations.  this starts
+// trying them off-screen, a generation every 20ms from the scheduler,
+// until one stays ACTIVE for LIFE_PREROLL generations (by default, the whole time
+// do_life() would give it); only its seed is kept.  it uses the gameboard, so only
+// while something else is on the display; life_seed() stops it.
+#ifndef LIFE_PREROLL
+#define LIFE_PREROLL LIFE_PATIENCE
+#endif
+void life_preroll(void);
+
+// call after setting up a new board (or changing cells by hand), so it isn't
+// compared against the old one and life() looks at every column again
+void life_reset_history(void);
+
+// draw the viewport into framebuf[dst..dst+DISPLAY_WIDTH-1]
+void life_render(uint8_t dst);
+
+// move the viewport (wrapping around the world).  it's drawn by the next life()/life_render().
+void life_pan(int8_t dx, int8_t dy);
+
+#endif
@@ -0,0 +1,88 @@
+// streaming decoder for the message store (see messages.h)
+
+#include "messages.h"
+#include "rng.h"
+
+// the smallest 2^k - 1 that covers every message number (but at least 3)
+#define SPAN0 (MESSAGE_COUNT - 1)
+#define SPAN1 (SPAN0 | SPAN0 >> 1)
+#define SPAN2 (SPAN1 | SPAN1 >> 2)
+#define SPAN3 (SPAN2 | SPAN2 >> 4)
+#define SPAN4 (SPAN3 | SPAN3 >> 8)
+#define MSG_MASK (SPAN4 | 3)
+
+#ifdef MSG_FLASH
+
+void msg_open(struct msg_reader *r, uint16_t n)
+{
+	uint8_t w[2];
+	flash_read(MSG_FLASH_BASE + 2 * (uint32_t)n, w, 2);
+	flash_open(&r->s, MSG_FLASH_BASE + 2 * (uint32_t)MESSAGE_COUNT + (w[0] | (uint16_t)w[1] << 8));
+	r->sp = 0;
+}
+
+#define NEXT_BYTE(r) flash_getc(&(r)->s)
+
+#else
+
+void msg_open(struct msg_reader *r, uint16_t n)
+{
+	r->p = msg_data + pgm_read_word(&msg_index[n]);
+	r->sp = 0;
+}
+
+#define NEXT_BYTE(r) pgm_read_byte((r)->p++)
+
+#endif
+
+uint8_t msg_getc(struct msg_reader *r)
+{
+	uint8_t c = r->sp ? r->stack[--r->sp] : NEXT_BYTE(r);
+	while (c >= 128)
+	{
+		const uint8_t *pair = msg_pairs[c - 128];
+		r->stack[r->sp++] = pgm_read_byte(pair + 1);
+		c = pgm_read_byte(pair);
+	}
+	return c;
+}
+
+// x = a * x + c mod 2^k goes through all 2^k values before repeating, as long as c
+// is odd and a is one more than a multiple of 4.  each pass gets a new a and c (and
+// starting point), so the order's different every time.  numbers past the last
+// message are skipped, which is fewer than half of them.
+struct msg_pick_state msg_state = { .last = 0xffff };
+
+static uint16_t rand16(void)
+{
+	return ((uint16_t)rand8() << 8) | rand8();
+}
+
+uint16_t msg_pick(void)
+{
+	struct msg_pick_state *m = &msg_state;
+	uint16_t x = m->x;
+	if (m->left > MSG_MASK + 1)
+		m->left = 0;	// left over from a different set of messages
+	for (;;) {
+		if (m->left == 0) {
+			m->a = (rand16() & MSG_MASK & ~3) | 1;
+			m->c = (rand16() & MSG_MASK) | 1;
+			x = rand16();
+			m->left = MSG_MASK + 1;
+		}
+		x = (m->a * x + m->c) & MSG_MASK;
+		--m->left;
+		if (x >= MESSAGE_COUNT)
+			continue;
+		// the last of one pass could come up first in the next.  skipping it would
+		// leave it out of the whole pass, so start the pass over in another order.
+		if (MESSAGE_COUNT > 1 && x == m->last) {
+			m->left = 0;
+			continue;
+		}
+		break;
+	}
+	m->x = m->last = x;
+	return x;
+}
@@ -0,0 +1,49 @@
+#ifndef MESSAGES_H
+#define MESSAGES_H
+
+#include <avr/pgmspace.h>
+
+#include "msgdata.h"	// generated from messages.txt by tools/msgpack
+#include "spiflash.h"
+
+// the compressed message store.  each byte of msg_data is either a character (< 128)
+// or a reference to a pair of bytes in msg_pairs, which can refer to further pairs.
+// msg_reader expands them on the fly, so nothing is ever decoded into a buffer.
+// with MSG_FLASH, msg_index and msg_data are read from the external flash instead
+// (msgdata.bin, at MSG_FLASH_BASE), so there can be as many messages as it holds.
+extern const uint8_t msg_pairs[][2] PROGMEM;
+#ifndef MSG_FLASH
+extern const uint16_t msg_index[MESSAGE_COUNT] PROGMEM;
+extern const uint8_t msg_data[] PROGMEM;
+#endif
+
+struct msg_reader
+{
+#ifdef MSG_FLASH
+	struct flash_stream s;
+#else
+	const uint8_t *p;
+#endif
+	uint8_t sp;
+	uint8_t stack[MSG_DEPTH];	// right halves of pairs, waiting their turn
+};
+
+// start reading message n (0 <= n < MESSAGE_COUNT)
+void msg_open(struct msg_reader *r, uint16_t n);
+
+// returns the next character of the message, or 0 at the end
+uint8_t msg_getc(struct msg_reader *r);
+
+// a random message number, without repeats until they've all come up
+uint16_t msg_pick(void);
+
+// where msg_pick() is in its current pass, so it can carry on after a power cycle (see persist.h)
+struct msg_pick_state
+{
+	uint16_t x, a, c;	// the generator
+	uint16_t left;		// numbers to go in this pass
+	uint16_t last;		// the last message picked
+};
+extern struct msg_pick_state msg_state;
+
+#endif
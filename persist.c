@@ -0,0 +1,145 @@
+// EEPROM warm start (see persist.h)
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <string.h>
+
+#include "persist.h"
+#include "messages.h"
+#include "font.h"
+#include "rng.h"
+#include "sched.h"
+#include "profile.h"
+
+struct warm_state
+{
+	uint16_t messages;	// MESSAGE_COUNT, since the pick state means nothing for another set
+	struct msg_pick_state pick;
+	uint16_t delay;
+	uint32_t seed;
+};
+
+struct record
+{
+	uint16_t seq;
+	struct warm_state s;
+	uint8_t check;
+};
+
+#define SLOTS ((E2END + 1) / sizeof(struct record))
+
+// how long to wait for things to settle down before writing
+#define SAVE_DELAY MILLIS(2000)
+
+// the record being written (and after that, the last one written)
+static struct record rec;
+static uint8_t slot;		// where rec goes
+static volatile uint8_t pos;	// the next byte of it to write
+
+static uint8_t checksum(const struct record *r)
+{
+	const uint8_t *p = (const uint8_t *)r;
+	uint8_t i, sum = 0xa5;	// so a zeroed record doesn't pass
+	for (i = 0; i < sizeof(*r) - 1; ++i)
+		sum += p[i];
+	return sum;
+}
+
+static uint8_t ee_read(uint16_t addr)
+{
+	EEAR = addr;
+	EECR |= (1 << EERE);
+	return EEDR;
+}
+
+uint8_t persist_load(void)
+{
+	struct record r;
+	uint8_t i, j, found = 0;
+
+	// (nothing's being written yet, so no need to wait for EEPE)
+	for (i = 0; i < SLOTS; ++i)
+	{
+		for (j = 0; j < sizeof(r); ++j)
+			((uint8_t *)&r)[j] = ee_read(i * sizeof(r) + j);
+		if (r.seq == 0xffff || r.check != checksum(&r))
+			continue;	// blank or torn
+		if (!found || (int16_t)(r.seq - rec.seq) > 0)
+		{
+			rec = r;
+			slot = i;
+			found = 1;
+		}
+	}
+	pos = sizeof(rec);	// the writer is idle
+	if (!found)
+	{
+		slot = SLOTS - 1;	// so the first record goes in slot 0
+		return 0;
+	}
+
+	if (rec.s.messages == MESSAGE_COUNT)
+		msg_state = rec.s.pick;
+	if (rec.s.delay != 0 && rec.s.delay <= MILLIS(208))
+		delay = rec.s.delay;
+	rng_seed(rec.s.seed);
+	return 1;
+}
+
+static void flush(void)
+{
+	struct warm_state s;
+
+	if (EECR & (1 << EERIE))
+	{
+		// the last one's still going in
+		sched_at(flush, now() + MILLIS(100), 0);
+		return;
+	}
+
+	memset(&s, 0, sizeof(s));
+	s.messages = MESSAGE_COUNT;
+	s.pick = msg_state;
+	s.delay = delay;
+	// the seed's different every time, but that alone isn't worth a write
+	s.seed = rec.s.seed;
+	if (memcmp(&s, &rec.s, sizeof(s)) == 0)
+		return;
+	s.seed = rng_state();
+
+	++rec.seq;
+	if (rec.seq == 0xffff)
+		rec.seq = 0;
+	rec.s = s;
+	rec.check = checksum(&rec);
+	if (++slot == SLOTS)
+		slot = 0;
+	pos = 0;
+	EECR |= (1 << EERIE);	// the interrupt goes off as soon as the EEPROM is ready
+}
+
+void persist_save(void)
+{
+	sched_at(flush, now() + SAVE_DELAY, 0);
+}
+
+// writes the next byte of rec that isn't already right
+ISR(EE_READY_vect)
+{
+	PROF_ISR_ENTER();
+	while (pos < sizeof(rec))
+	{
+		uint16_t addr = slot * sizeof(rec) + pos;
+		uint8_t b = ((const uint8_t *)&rec)[pos++];
+		if (ee_read(addr) != b)
+		{
+			EEDR = b;
+			EECR |= (1 << EEMPE);
+			EECR |= (1 << EEPE);
+			PROF_ISR_EXIT();
+			return;
+		}
+	}
+	EECR &= ~(1 << EERIE);
+	PROF_ISR_EXIT();
+}
@@ -0,0 +1,23 @@
+#ifndef PERSIST_H
+#define PERSIST_H
+
+#include <stdint.h>
+
+// warm start: msg_pick()'s place, the scroll speed and the RNG state are kept in EEPROM,
+// so a power cycle carries on with the next quote, at the same speed, without waiting
+// for the ADC to come up with a seed.
+//
+// the EEPROM is divided into as many records as fit, written round-robin, so each cell
+// only takes one write in that many; every record has a sequence number and a checksum,
+// and the newest good one wins (a record cut short by a power failure just doesn't count).
+// records are written a byte at a time from the EEPROM ready interrupt, so nothing waits
+// the 3.4ms each byte takes, and bytes that are already right are skipped.
+
+// restores the newest saved state; returns 0 if there isn't one (first boot, or bad)
+uint8_t persist_load(void);
+
+// saves the state a couple of seconds from now.  calls in the meantime just push that
+// back, so a burst of changes is one write; nothing's written if nothing has changed.
+void persist_save(void);
+
+#endif
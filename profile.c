@@ -0,0 +1,92 @@
+// counters for -DPROFILE (see profile.h)
+
+#ifdef PROFILE
+
+#include <avr/io.h>
+#include <util/atomic.h>
+#include <string.h>
+
+#include "profile.h"
+#include "display.h"
+#include "font.h"
+#include "sched.h"
+
+volatile struct profile prof;
+
+void profile_init(void)
+{
+	DDRB |= (1 << PB6) | (1 << PB7);
+	memset((void *)&prof, 0, sizeof(prof));
+	prof.last = now();
+}
+
+void profile_clock(void)
+{
+	uint16_t t = now();
+	prof.elapsed_kc += (uint16_t)(t - prof.last);
+	prof.last = t;
+}
+
+static char *put_num(char *p, uint32_t n)
+{
+	char digits[10];
+	uint8_t i = 0;
+	do {
+		digits[i++] = '0' + n % 10;
+		n /= 10;
+	} while (n);
+	while (i)
+		*p++ = digits[--i];
+	return p;
+}
+
+static char *put_field(char *p, const char *name, uint32_t n, const char *unit)
+{
+	while (*name)
+		*p++ = *name++;
+	p = put_num(p, n);
+	while (*unit)
+		*p++ = *unit++;
+	return p;
+}
+
+#define KC_PER_SEC ((uint32_t)F_CPU / 1024)
+
+void profile_show(uint8_t color)
+{
+	struct profile p;
+	char text[80], *t = text;
+	uint32_t elapsed;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		profile_clock();
+		p = *(struct profile *)&prof;
+		memset((void *)&prof, 0, sizeof(prof));
+		prof.last = p.last;
+	}
+	elapsed = p.elapsed_kc;
+	if (elapsed == 0)
+		elapsed = 1;
+
+	// timer0 ticks are 64 cycles, kiloclocks 1024
+	// (what the ISRs do while we're asleep counts as idle time, so it gets added back)
+	uint32_t isr = p.isr_ticks / 16 * 100 / elapsed;
+	uint32_t load = p.idle_kc * 100 / elapsed;
+	load = (load > 100 ? 0 : 100 - load) + isr;
+	t = put_field(t, "   load ", load > 100 ? 100 : load, "%");
+	t = put_field(t, " isr ", isr, "%");
+	t = put_field(t, " lat ", p.latency_worst * 64UL, "c");
+	t = put_field(t, " max ", p.isr_worst * 64UL, "c");
+	t = put_field(t, " life ", p.life_calls ? p.life_kc * 1024 / p.life_calls / (F_CPU / 1000000) : 0, "us");
+	t = put_field(t, " fps ", p.frames * KC_PER_SEC / elapsed, "   ");
+	*t = 0;
+
+	clear_screen(0, FB_COLS);
+	fb_base = 0;
+	display_update();
+	DrawText(text, color);
+	scroll_wait();
+}
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+// optional instrumentation, built in with -DPROFILE.
+//
+// PB6 toggles on entry to and exit from each ISR, and PB7 around the hot foreground
+// functions (life(), display_update()), so a scope or logic analyzer shows exactly
+// where the time goes.  counters are kept too, and profile_show() scrolls a summary
+// across the display:
+//   load  percent of the time the CPU was awake
+//   isr   percent of the time spent in the refresh, fade and ADC ISRs
+//   lat   worst refresh ISR latency, in cycles (to the nearest 64)
+//   max   worst refresh ISR run time, in cycles (likewise)
+//   life  average life() time, in microseconds (timed in kiloclocks, so it's rough)
+//   fps   full display refreshes per second
+
+#ifdef PROFILE
+
+#include <avr/io.h>
+#include <stdint.h>
+
+struct profile
+{
+	uint32_t isr_ticks;	// timer0 ticks (64 cycles) spent in the refresh, fade and ADC ISRs
+	uint8_t isr_worst;	// longest refresh ISR, in timer0 ticks
+	uint8_t latency_worst;	// most timer0 ticks from compare match to the refresh ISR running
+	uint32_t frames;	// full passes over the 8 columns
+	uint16_t life_calls;
+	uint32_t life_kc;	// kiloclocks spent in life()
+	uint32_t idle_kc;	// kiloclocks asleep (which includes ISRs that ran meanwhile)
+	uint32_t elapsed_kc;	// kiloclocks since counting began, as of the last profile_clock()
+	uint16_t last;		// now() at the last profile_clock()
+};
+
+extern volatile struct profile prof;
+
+// timer0 is cleared by the compare match, so on the way into the refresh ISR
+// TCNT0 is how long it's been waiting.
+#define PROF_ISR_ENTER() uint8_t prof_t0_ = TCNT0; PINB = (1 << PB6)
+#define PROF_REFRESH_EXIT() do { \
+	uint8_t d_ = TCNT0 - prof_t0_; \
+	PINB = (1 << PB6); \
+	prof.isr_ticks += d_; \
+	if (d_ > prof.isr_worst) prof.isr_worst = d_; \
+	if (prof_t0_ > prof.latency_worst) prof.latency_worst = prof_t0_; \
+} while (0)
+#define PROF_ISR_EXIT() do { prof.isr_ticks += (uint8_t)(TCNT0 - prof_t0_); PINB = (1 << PB6); } while (0)
+#define PROF_FRAME() ++prof.frames
+
+// just the pin, for ISRs that run long enough for timer0 to wrap in the middle
+#define PROF_PIN_ISR() PINB = (1 << PB6)
+
+#define PROF_FN_ENTER() PINB = (1 << PB7)
+#define PROF_FN_EXIT() PINB = (1 << PB7)
+
+// makes PB6 and PB7 outputs and starts counting
+void profile_init(void);
+
+// adds the time since the last call to elapsed_kc.  timer1 wraps every 8.4 seconds,
+// so this has to run more often than that: the scheduler calls it every time it idles.
+void profile_clock(void);
+
+// scrolls the numbers since the last call (or profile_init()) across the display,
+// then starts counting afresh
+void profile_show(uint8_t color);
+
+#else
+
+#define PROF_ISR_ENTER()
+#define PROF_REFRESH_EXIT() do {} while (0)
+#define PROF_ISR_EXIT() do {} while (0)
+#define PROF_FRAME() do {} while (0)
+#define PROF_PIN_ISR() do {} while (0)
+#define PROF_FN_ENTER() do {} while (0)
+#define PROF_FN_EXIT() do {} while (0)
+
+#endif
+
+#endif
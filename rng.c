@@ -0,0 +1,61 @@
+// random numbers without waiting around for the ADC
+//
+// the ADC is auto-triggered by the display timer (timer0 compare A), so a conversion
+// of the floating PORTC3 input completes on every column refresh.  its interrupt folds
+// the noisy LSB, along with wherever timer1 happened to be, into a small pool.
+// rand8() mixes the pool into a xorshift generator, so random bytes are available
+// immediately and keep picking up fresh entropy as it comes in.  a scheduled task
+// stirs the pool in every 10ms too, so it isn't just overwritten while nobody's asking.
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "rng.h"
+#include "sched.h"
+#include "profile.h"
+
+static volatile uint8_t pool;
+static uint32_t state = 0x6d617472;
+
+ISR(ADC_vect)
+{
+	PROF_ISR_ENTER();
+	uint8_t p = pool;
+	pool = ((p << 1) | (p >> 7)) ^ (uint8_t)ADCW ^ TCNT1L;
+	PROF_ISR_EXIT();
+}
+
+static void stir(void)
+{
+	rand8();
+}
+
+void rng_init(void)
+{
+	ADMUX = 3;
+	ADCSRB = (1<<ADTS1) | (1<<ADTS0);	// trigger on timer0 compare match A
+	ADCSRA = (1<<ADEN) | (1<<ADATE) | (1<<ADIE) | (1<<ADPS2) | (1<<ADPS1);	// 125kHz ADC clock
+	sched_at(stir, now() + MILLIS(10), MILLIS(10));
+}
+
+uint8_t rand8(void)
+{
+	uint32_t x = state ^ pool;
+	if (x == 0)
+		x = 1;	// xorshift's one stuck state
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	state = x;
+	return (uint8_t)(x >> 24);
+}
+
+uint32_t rng_state(void)
+{
+	return state;
+}
+
+void rng_seed(uint32_t seed)
+{
+	state = seed;
+}
@@ -0,0 +1,16 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// starts harvesting noise from the floating PORTC3 input in the background
+void rng_init(void);
+
+// returns a random byte right away (xorshift, stirred with the harvested noise)
+uint8_t rand8(void);
+
+// the generator's state, for picking up where it left off after a power cycle
+uint32_t rng_state(void);
+void rng_seed(uint32_t seed);
+
+#endif
@@ -0,0 +1,190 @@
+// a tiny cooperative scheduler on a free-running timer1
+//
+// the compare match A interrupt is aimed at the nearest deadline, whether that's
+// a queued task or the end of the current sleep, so the CPU stays in idle mode
+// in between.  the deadline is checked with interrupts off and the sleep follows the
+// sei, so a compare that matches in the meantime still wakes it: nothing else is
+// sure to, since the refresh stops while the display's blank.
+//
+// when nothing needs the system clock -- the display's off because it's blank, and
+// no text is scrolling, button being debounced or serial port listening -- a long
+// sleep is done in power-down instead, a watchdog tick at a time.  timer1 stops then, so the watchdog interrupt
+// moves it on by a tick's worth; a button press that wakes us early costs up to a tick.
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+
+#include "sched.h"
+#include "profile.h"
+
+struct task
+{
+	task_fn fn;
+	uint16_t when;
+	uint16_t period;
+};
+
+static struct task tasks[SCHED_SLOTS];
+
+EMPTY_INTERRUPT(TIMER1_COMPA_vect);
+
+// the watchdog's shortest timeout.  (its oscillator isn't very accurate, but this
+// is only while the display's off, and tasks will just be a bit early or late.)
+#define WDT_TICK MILLIS(16)
+
+ISR(WDT_vect)
+{
+	TCNT1 += WDT_TICK;
+}
+
+void sched_init(void)
+{
+	TCCR1A = 0;
+	TCCR1B = (1 << CS12) | (1 << CS10);	// normal mode, 1/1024 prescaler
+	TIMSK1 = (1 << OCIE1A);
+}
+
+uint16_t now(void)
+{
+	uint16_t t;
+	// the high byte goes through the shared TEMP register, which an interrupt could clobber
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		t = TCNT1;
+	}
+	return t;
+}
+
+uint8_t sched_at(task_fn fn, uint16_t when, uint16_t period)
+{
+	struct task *t, *slot = 0;
+	for(t = tasks; t < tasks + SCHED_SLOTS; ++t)
+	{
+		if (t->fn == fn) {
+			slot = t;
+			break;
+		}
+		if (!t->fn && !slot)
+			slot = t;
+	}
+	if (!slot)
+		return 0;
+	slot->fn = fn;
+	slot->when = when;
+	slot->period = period;
+	return 1;
+}
+
+void sched_cancel(task_fn fn)
+{
+	struct task *t;
+	for(t = tasks; t < tasks + SCHED_SLOTS; ++t)
+	{
+		if (t->fn == fn)
+			t->fn = 0;
+	}
+}
+
+// runs whatever is due; returns the nearest deadline, no later than limit
+static uint16_t run_tasks(uint16_t limit)
+{
+	struct task *t;
+	for(t = tasks; t < tasks + SCHED_SLOTS; ++t)
+	{
+		task_fn fn = t->fn;
+		if (!fn)
+			continue;
+		if (DUE(t->when)) {
+			if (t->period) {
+				t->when += t->period;
+			} else {
+				t->fn = 0;
+			}
+			fn();
+			if (!t->fn)
+				continue;
+		}
+		if ((int16_t)(t->when - limit) < 0)
+			limit = t->when;
+	}
+	return limit;
+}
+
+// everything clocked from the system clock has to be stopped
+static uint8_t can_power_down(void)
+{
+	return TCCR0B == 0			// display refresh
+		&& !(TIMSK1 & (1 << OCIE1B))	// text scroller
+		&& TCCR2B == 0			// button debounce
+		&& !(UCSR0B & (1 << RXEN0))	// serial input
+		&& !(EECR & (1 << EERIE));	// EEPROM writer (its interrupt doesn't wake us)
+}
+
+// one watchdog tick in power-down, or less if a button is pressed
+static void power_down(void)
+{
+	uint8_t adc = ADCSRA;
+	ADCSRA = adc & ~(1 << ADEN);	// it'd draw current the whole time otherwise
+	cli();
+	WDTCSR = (1 << WDCE) | (1 << WDE);
+	WDTCSR = (1 << WDIE);		// interrupt (not reset) after 16ms
+	set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+	sleep_enable();
+	sei();
+	sleep_cpu();
+	sleep_disable();
+	cli();
+	WDTCSR = (1 << WDCE) | (1 << WDE);
+	WDTCSR = 0;
+	sei();
+	ADCSRA = adc;
+}
+
+// runs what's due, then idles until an interrupt (and no later than when).
+// tasks that come due during a power-down run late, at the end of the tick.
+static void idle(uint16_t when)
+{
+	uint16_t next = run_tasks(when);
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		OCR1A = next;
+	}
+#ifdef PROFILE
+	uint16_t t = now();
+#endif
+	if ((int16_t)(when - now()) > WDT_TICK && can_power_down()) {
+		power_down();
+	} else {
+		set_sleep_mode(SLEEP_MODE_IDLE);
+		cli();
+		if (!DUE(next)) {
+			sleep_enable();
+			sei();		// the instruction after the sei runs before any interrupt
+			sleep_cpu();
+			sleep_disable();
+		}
+		sei();
+	}
+#ifdef PROFILE
+	prof.idle_kc += (uint16_t)(now() - t);
+	profile_clock();
+#endif
+}
+
+void sleep_until(uint16_t when)
+{
+	while (!DUE(when))
+		idle(when);
+}
+
+void sched_idle(void)
+{
+	idle(now() + 0x7fff);
+}
+
+void Sleep(uint16_t kiloclocks)
+{
+	sleep_until(now() + kiloclocks);
+}
@@ -0,0 +1,45 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdint.h>
+
+// timer1 runs freely at 1/1024 of the system clock, so time is kept in "kiloclocks".
+// the counter wraps every 8.4 seconds; deadlines are compared relative to the
+// current time, so keep them within about 4 seconds of it.
+
+// convert milliseconds to "kiloclocks" for Sleep(), assuming 8MHz system clock
+// intended for literals; let the compiler do the floating-point math, not the poor AVR ;)
+#define MILLIS(x) ((uint16_t)(7.812 * (x)))
+
+// true once time t has arrived
+#define DUE(t) ((int16_t)((t) - now()) <= 0)
+
+typedef void (*task_fn)(void);
+
+#define SCHED_SLOTS 4
+
+void sched_init(void);
+
+// the current time
+uint16_t now(void);
+
+// run fn at time when, and then every period kiloclocks after that (if period isn't 0).
+// tasks only run from inside sleep_until() / Sleep(), so they never interrupt anything.
+// scheduling a task that's already queued just moves it; returns 0 if there's no room.
+uint8_t sched_at(task_fn fn, uint16_t when, uint16_t period);
+void sched_cancel(task_fn fn);
+
+// idle until time when, running any tasks that come due in the meantime.
+// (if the display is blank and nothing else is going on, that's in power-down.)
+// for a steady cadence, keep adding the period to the previous deadline
+// rather than calling Sleep(), so time spent working doesn't add up.
+void sleep_until(uint16_t when);
+
+// run any tasks that are due, then idle until the next interrupt.
+// for waiting on something an interrupt handler does: while (!done) sched_idle();
+void sched_idle(void);
+
+// idle for the specified number of kiloclocks
+void Sleep(uint16_t kiloclocks);
+
+#endif
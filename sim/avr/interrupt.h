@@ -0,0 +1,11 @@
+#ifndef SIM_AVR_INTERRUPT_H
+#define SIM_AVR_INTERRUPT_H
+// vectors become ordinary functions so the harness can invoke them directly
+#define ISR_NAKED
+#define ISR_NOBLOCK
+#define ISR(vector, ...) void vector(void); void vector(void)
+#define reti() return
+#define EMPTY_INTERRUPT(vector) void vector(void); void vector(void) {}
+void sei(void);
+void cli(void);
+#endif
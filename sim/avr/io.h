@@ -0,0 +1,128 @@
+// host stand-in for <avr/io.h>: every register is a plain variable (see sim.c)
+#ifndef SIM_AVR_IO_H
+#define SIM_AVR_IO_H
+#include <stdint.h>
+
+#define SIM_REG8(name)  extern volatile uint8_t name;
+#define SIM_REG16(name) extern volatile uint16_t name;
+#include "regs.h"
+#undef SIM_REG8
+#undef SIM_REG16
+
+#define WGM00    0
+#define WGM01    1
+#define CS00     0
+#define CS01     1
+#define CS02     2
+#define OCIE0A   1
+#define OCIE0B   2
+#define TOIE0    0
+#define OCF0A    1
+#define OCF0B    2
+#define WGM12    3
+#define CS10     0
+#define CS11     1
+#define CS12     2
+#define OCIE1A   1
+#define OCIE1B   2
+#define TOIE1    0
+#define OCF1A    1
+#define OCF1B    2
+#define TOV1     0
+#define WGM21    1
+#define CS20     0
+#define CS21     1
+#define CS22     2
+#define OCIE2A   1
+#define OCIE2B   2
+#define OCF2A    1
+#define OCF2B    2
+#define ADEN     7
+#define ADSC     6
+#define ADATE    5
+#define ADIF     4
+#define ADIE     3
+#define ADPS2    2
+#define ADPS1    1
+#define ADPS0    0
+#define ADTS2    2
+#define ADTS1    1
+#define ADTS0    0
+#define REFS0    6
+#define ADC3D    3
+#define SPIE     7
+#define SPE      6
+#define DORD     5
+#define MSTR     4
+#define CPOL     3
+#define CPHA     2
+#define SPR1     1
+#define SPR0     0
+#define SPIF     7
+#define SPI2X    0
+#define RXC0     7
+#define TXC0     6
+#define UDRE0    5
+#define U2X0     1
+#define RXCIE0   7
+#define TXCIE0   6
+#define UDRIE0   5
+#define RXEN0    4
+#define TXEN0    3
+#define UCSZ01   2
+#define UCSZ00   1
+#define FE0      4
+#define DOR0     3
+#define PCIE1    1
+#define PCIF1    1
+#define PCINT12  4
+#define PCINT13  5
+#define EERIE    3
+#define EEMPE    2
+#define EEPE     1
+#define EERE     0
+#define WDIF     7
+#define WDIE     6
+#define WDP3     5
+#define WDCE     4
+#define WDE      3
+#define WDP2     2
+#define WDP1     1
+#define WDP0     0
+#define WDRF     3
+#define PRTWI    7
+#define PRTIM2   6
+#define PRTIM0   5
+#define PRTIM1   3
+#define PRSPI    2
+#define PRUSART0 1
+#define PRADC    0
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PB6 6
+#define PB7 7
+#define PC0 0
+#define PC1 1
+#define PC2 2
+#define PC3 3
+#define PC4 4
+#define PC5 5
+#define PC6 6
+#define PC7 7
+#define PD0 0
+#define PD1 1
+#define PD2 2
+#define PD3 3
+#define PD4 4
+#define PD5 5
+#define PD6 6
+#define PD7 7
+
+#define _BV(bit) (1 << (bit))
+#define RAMEND 0x4ff
+#define E2END 0x1ff
+#endif
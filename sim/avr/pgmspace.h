@@ -0,0 +1,14 @@
+#ifndef SIM_AVR_PGMSPACE_H
+#define SIM_AVR_PGMSPACE_H
+#include <stdint.h>
+#include <string.h>
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(p)       (*(const uint8_t *)(p))
+#define pgm_read_byte_near(p)  pgm_read_byte(p)
+#define pgm_read_word(p)       (*(const uint16_t *)(p))
+#define pgm_read_word_near(p)  pgm_read_word(p)
+#define pgm_read_ptr(p)        (*(p))
+#define memcpy_P memcpy
+#define strlen_P strlen
+#endif
@@ -0,0 +1,13 @@
+// the ATmega88P registers the firmware touches
+SIM_REG8(PORTB) SIM_REG8(DDRB) SIM_REG8(PINB)
+SIM_REG8(PORTC) SIM_REG8(DDRC) SIM_REG8(PINC)
+SIM_REG8(PORTD) SIM_REG8(DDRD) SIM_REG8(PIND)
+SIM_REG8(TCCR0A) SIM_REG8(TCCR0B) SIM_REG8(TCNT0) SIM_REG8(OCR0A) SIM_REG8(OCR0B) SIM_REG8(TIMSK0) SIM_REG8(TIFR0)
+SIM_REG8(TCCR1A) SIM_REG8(TCCR1B) SIM_REG16(TCNT1) SIM_REG8(TCNT1L) SIM_REG16(OCR1A) SIM_REG16(OCR1B) SIM_REG8(TIMSK1) SIM_REG8(TIFR1)
+SIM_REG8(TCCR2A) SIM_REG8(TCCR2B) SIM_REG8(TCNT2) SIM_REG8(OCR2A) SIM_REG8(OCR2B) SIM_REG8(TIMSK2) SIM_REG8(TIFR2)
+SIM_REG8(ADCSRA) SIM_REG8(ADCSRB) SIM_REG8(ADMUX) SIM_REG16(ADCW) SIM_REG8(ADCL) SIM_REG8(ADCH) SIM_REG8(DIDR0)
+SIM_REG8(SPCR) SIM_REG8(SPSR) SIM_REG8(SPDR)
+SIM_REG8(UCSR0A) SIM_REG8(UCSR0B) SIM_REG8(UCSR0C) SIM_REG16(UBRR0) SIM_REG8(UDR0)
+SIM_REG8(PCICR) SIM_REG8(PCIFR) SIM_REG8(PCMSK0) SIM_REG8(PCMSK1) SIM_REG8(PCMSK2)
+SIM_REG8(EECR) SIM_REG8(EEDR) SIM_REG16(EEAR)
+SIM_REG8(WDTCSR) SIM_REG8(MCUSR) SIM_REG8(SMCR) SIM_REG8(PRR) SIM_REG8(GPIOR0) SIM_REG8(SREG)
@@ -0,0 +1,13 @@
+#ifndef SIM_AVR_SLEEP_H
+#define SIM_AVR_SLEEP_H
+#define SLEEP_MODE_IDLE       0
+#define SLEEP_MODE_ADC        1
+#define SLEEP_MODE_PWR_DOWN   2
+#define SLEEP_MODE_PWR_SAVE   3
+#define set_sleep_mode(mode)  ((void)(mode))
+#define sleep_enable()
+#define sleep_disable()
+#define sleep_cpu()           sim_sleep()
+#define sleep_mode()          sim_sleep()
+void sim_sleep(void);
+#endif
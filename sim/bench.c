@@ -0,0 +1,233 @@
+// benchmark for the rendering and Life code
+//
+// "make bench" builds this for the host against the stub headers in sim/,
+// which is good for spotting regressions but counts the host's cycles.
+// "make bench-avr" builds it for the real chip and runs it under simavr;
+// then the counts are AVR cycles and the report comes out of the UART.
+
+#include <avr/io.h>
+#include <stdio.h>
+
+#include "display.h"
+#include "font.h"
+#include "life.h"
+#include "rng.h"
+#include "messages.h"
+
+#ifdef __AVR__
+
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+#include "sched.h"
+
+// timer1 belongs to the scheduler (and the scroller's cadence), at its usual 1/1024,
+// so the stamps come from timer2 at 1/8, counting its overflows in software.
+// (the overflow interrupt, every 2048 cycles, adds a little to the worst cases.)
+#define UNITS "AVR cycles, to the nearest 8"
+typedef uint32_t stamp_t;
+
+static volatile uint16_t stamp_hi;
+
+ISR(TIMER2_OVF_vect)
+{
+	++stamp_hi;
+}
+
+static stamp_t stamp(void)
+{
+	uint16_t h;
+	uint8_t l;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		h = stamp_hi;
+		l = TCNT2;
+		// wrapped since the interrupts went off, and not counted yet
+		if ((TIFR2 & (1 << TOV2)) && l < 0x80)
+			++h;
+	}
+	return (((stamp_t)h << 8) | l) * 8;
+}
+
+#define CLOCK_START() stamp()
+#define CLOCK_READ() stamp()
+
+static int uart_putchar(char c, FILE *f)
+{
+	if (c == '\n')
+		uart_putchar('\r', f);
+	while (!(UCSR0A & (1 << UDRE0)));
+	UDR0 = c;
+	return 0;
+}
+
+static FILE uart = FDEV_SETUP_STREAM(uart_putchar, NULL, _FDEV_SETUP_WRITE);
+
+// timer1 ticks a kiloclock, so that's as fast as the scroller can go
+#define SCROLL_DELAY 1
+
+static void bench_init(void)
+{
+	UBRR0 = 25;			// 38400 baud with U2X
+	UCSR0A = (1 << U2X0);
+	UCSR0B = (1 << TXEN0);
+	stdout = &uart;
+	TCCR2A = 0;
+	TCCR2B = (1 << CS21);
+	TIMSK2 = (1 << TOIE2);
+	sched_init();
+	sei();			// the scroller waits on timer1 interrupts
+}
+
+#else
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define UNITS "host TSC cycles"
+typedef uint64_t stamp_t;
+#define CLOCK_START() __rdtsc()
+#define CLOCK_READ() __rdtsc()
+#else
+#include <time.h>
+#define UNITS "host ns"
+typedef uint64_t stamp_t;
+static stamp_t ns(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (stamp_t)t.tv_sec * 1000000000u + t.tv_nsec;
+}
+#define CLOCK_START() ns()
+#define CLOCK_READ() ns()
+#endif
+
+// the stub timer jumps straight to the next compare, so there's no waiting at all
+#define SCROLL_DELAY 0
+
+static void bench_init(void) {}
+
+#endif
+
+#define TIME(total, worst, what) do { \
+	stamp_t t0_ = CLOCK_START(); \
+	what; \
+	uint32_t dt_ = (uint32_t)(CLOCK_READ() - t0_); \
+	total += dt_; \
+	if (dt_ > worst) worst = dt_; \
+} while (0)
+
+static void report(const char *what, uint32_t total, uint32_t n, uint32_t worst)
+{
+	printf("%-22s %8lu avg %8lu worst\n", what, (unsigned long)(total / n), (unsigned long)worst);
+}
+
+static void bench_life(void)
+{
+	uint32_t total = 0, worst = 0;
+	uint16_t i;
+	uint8_t state = DEAD;
+	for(i = 0; i < 1000; ++i) {
+		if (state != ACTIVE)
+			life_seed();
+		TIME(total, worst, state = life(DISPLAY_WIDTH));
+	}
+	report("life() / generation", total, i,  worst);
+}
+
+static void bench_scroll(void)
+{
+	uint32_t total = 0, worst = 0, columns = 0;
+	uint8_t c;
+	delay = SCROLL_DELAY;
+	for(c = 32; c < 127; ++c) {
+		// one character at a time, rendered and scrolled all the way in
+		uint8_t base = fb_base, n;
+		stamp_t t0 = CLOCK_START();
+		scroll_char(c, 3);
+		scroll_wait();
+		uint32_t dt = (uint32_t)(CLOCK_READ() - t0);
+		n = (fb_base - base) & FB_MASK;
+		if (n == 0)
+			continue;
+		total += dt;
+		columns += n;
+		if (dt / n > worst)
+			worst = dt / n;
+	}
+	// on the AVR each column waits at least the one-kiloclock cadence
+	report("scroll / column", total, columns, worst);
+}
+
+static void bench_messages(void)
+{
+	uint32_t total = 0, worst = 0, n = 0;
+	uint16_t i;
+	for(i = 0; i < MESSAGE_COUNT; ++i) {
+		struct msg_reader r;
+		uint8_t c = 1;
+		msg_open(&r, i);
+		while (c) {
+			TIME(total, worst, c = msg_getc(&r));
+			++n;
+		}
+	}
+	report("msg_getc() / char", total, n, worst);
+}
+
+void TIMER0_COMPA_vect(void);
+
+static void bench_refresh(void)
+{
+	uint32_t total = 0, worst = 0;
+	uint16_t i;
+	for(i = 0; i < FB_COLS; ++i)
+		framebuf[i] = ((uint16_t)rand8() << 8) | rand8();
+	TIME(total, worst, display_update());
+	report("display_update()", total, 1, worst);
+
+	// what a stamp costs by itself, to take off the ISR times
+	uint32_t none = 0, none_worst = 0;
+	for(i = 0; i < 100; ++i)
+		TIME(none, none_worst, );
+	none /= i;
+
+	// the column that ends a frame also runs display_frame(), so it's counted apart
+	uint32_t frame_total = 0, frame_worst = 0, frames = 0;
+	total = worst = 0;
+	for(i = 0; i < 8000; ++i) {
+		uint8_t f = display_frames;
+		stamp_t t0 = CLOCK_START();
+		TIMER0_COMPA_vect();
+		uint32_t dt = (uint32_t)(CLOCK_READ() - t0);
+		dt = dt > none ? dt - none : 0;
+		if (f != display_frames) {
+			frame_total += dt;
+			++frames;
+			if (dt > frame_worst)
+				frame_worst = dt;
+		} else {
+			total += dt;
+			if (dt > worst)
+				worst = dt;
+		}
+	}
+	report("refresh ISR / column", total, i - frames, worst);
+	report("refresh ISR / frame", frame_total, frames, frame_worst);
+}
+
+int main(void)
+{
+	bench_init();
+	printf("matrix bench (" UNITS ")\n");
+	bench_life();
+	bench_scroll();
+	bench_messages();
+	bench_refresh();
+#ifdef __AVR__
+	// simavr stops when the CPU sleeps with interrupts off
+	cli();
+	sleep_enable();
+	sleep_cpu();
+#endif
+	return 0;
+}
@@ -0,0 +1,33 @@
+// register storage and the few bits of behavior the firmware depends on,
+// for building it on the host (see the bench target in the Makefile)
+
+#include <avr/io.h>
+#include <avr/sleep.h>
+
+#define SIM_REG8(name)  volatile uint8_t name;
+#define SIM_REG16(name) volatile uint16_t name;
+#include <avr/regs.h>
+
+__attribute__((constructor)) static void sim_reset(void)
+{
+	SPSR = (1 << SPIF);	// SPI transfers finish instantly
+	PINC = 0x30;		// buttons up
+}
+
+void sei(void) {}
+void cli(void) {}
+
+// the text scroller's interrupt, if it's linked in
+void TIMER1_COMPB_vect(void) __attribute__((weak));
+
+// idle until the next interrupt: as far as the firmware's concerned,
+// that's timer1 reaching one of its compare values
+void sim_sleep(void)
+{
+	if ((TIMSK1 & (1 << OCIE1B)) && TIMER1_COMPB_vect && (int16_t)(OCR1B - OCR1A) <= 0) {
+		TCNT1 = OCR1B;
+		TIMER1_COMPB_vect();
+	} else {
+		TCNT1 = OCR1A;
+	}
+}
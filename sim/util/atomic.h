@@ -0,0 +1,8 @@
+#ifndef SIM_UTIL_ATOMIC_H
+#define SIM_UTIL_ATOMIC_H
+#define ATOMIC_RESTORESTATE 0
+#define ATOMIC_FORCEON 0
+#define NONATOMIC_RESTORESTATE 0
+#define ATOMIC_BLOCK(type) for (int sim_once_ = 1; sim_once_; sim_once_ = 0)
+#define NONATOMIC_BLOCK(type) ATOMIC_BLOCK(type)
+#endif
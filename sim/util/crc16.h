@@ -0,0 +1,19 @@
+#ifndef SIM_UTIL_CRC16_H
+#define SIM_UTIL_CRC16_H
+#include <stdint.h>
+// C equivalents from the avr-libc documentation
+static inline uint16_t _crc_ccitt_update(uint16_t crc, uint8_t data)
+{
+	data ^= (uint8_t)crc;
+	data ^= data << 4;
+	return ((((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^ ((uint16_t)data << 3));
+}
+static inline uint16_t _crc16_update(uint16_t crc, uint8_t a)
+{
+	int i;
+	crc ^= a;
+	for (i = 0; i < 8; ++i)
+		crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : (crc >> 1);
+	return crc;
+}
+#endif
@@ -0,0 +1,100 @@
+// external SPI flash (see spiflash.h)
+
+#ifdef MSG_FLASH
+
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#include "spiflash.h"
+
+#define CMD_READ 0x03
+
+#define CS_LOW()  PORTB &= ~(1 << PB1)
+#define CS_HIGH() PORTB |= (1 << PB1)
+
+// only the display's ISR shares the bus, and only with DISPLAY_SPI
+#ifdef DISPLAY_SPI
+#define BUS_LOCKED ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#else
+#define BUS_LOCKED
+#endif
+
+void flash_init(void)
+{
+	CS_HIGH();
+	DDRB |= (1 << PB1) | (1 << PB2) | (1 << PB3) | (1 << PB5);	// CS, SS, MOSI, SCK
+#ifndef DISPLAY_SPI
+	SPCR = (1 << SPE) | (1 << MSTR);	// master, mode 0
+	SPSR = (1 << SPI2X);			// fosc/2 = 4MHz
+#endif
+}
+
+static uint8_t spi_byte(uint8_t b)
+{
+	SPDR = b;
+	while (!(SPSR & (1 << SPIF)))
+		;
+	return SPDR;
+}
+
+// the flash wants MSB first, which the display's SPI setup isn't.
+// reads n bytes into buf, starting at index i and wrapping at mask.
+static void burst(uint32_t addr, uint8_t *buf, uint8_t i, uint8_t mask, uint8_t n)
+{
+	BUS_LOCKED
+	{
+		uint8_t spcr = SPCR;
+		SPCR = spcr & ~(1 << DORD);
+		(void)SPSR;	// clear a leftover SPIF
+		(void)SPDR;
+		CS_LOW();
+		spi_byte(CMD_READ);
+		spi_byte(addr >> 16);
+		spi_byte(addr >> 8);
+		spi_byte(addr);
+		while (n-- > 0) {
+			buf[i] = spi_byte(0);
+			i = (i + 1) & mask;
+		}
+		CS_HIGH();
+		SPCR = spcr;
+	}
+}
+
+void flash_read(uint32_t addr, uint8_t *buf, uint8_t n)
+{
+	while (n > FLASH_BURST) {
+		burst(addr, buf, 0, 0xff, FLASH_BURST);
+		addr += FLASH_BURST;
+		buf += FLASH_BURST;
+		n -= FLASH_BURST;
+	}
+	burst(addr, buf, 0, 0xff, n);
+}
+
+static void prefetch(struct flash_stream *s)
+{
+	burst(s->next, s->buf, (s->head + s->count) & (FLASH_PREFETCH - 1),
+		FLASH_PREFETCH - 1, FLASH_BURST);
+	s->next += FLASH_BURST;
+	s->count += FLASH_BURST;
+}
+
+void flash_open(struct flash_stream *s, uint32_t addr)
+{
+	s->next = addr;
+	s->head = s->count = 0;
+	while (s->count <= FLASH_PREFETCH - FLASH_BURST)
+		prefetch(s);
+}
+
+uint8_t flash_getc(struct flash_stream *s)
+{
+	uint8_t c = s->buf[s->head];
+	s->head = (s->head + 1) & (FLASH_PREFETCH - 1);
+	if (--s->count <= FLASH_PREFETCH - FLASH_BURST)
+		prefetch(s);
+	return c;
+}
+
+#endif
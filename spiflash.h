@@ -0,0 +1,50 @@
+#ifndef SPIFLASH_H
+#define SPIFLASH_H
+
+// external SPI flash, built in with -DMSG_FLASH: any 25-series part (W25Q, AT25, SST25 ...)
+// that takes the plain 0x03 read command with a 24-bit address.
+//
+// PORTB1 (output) = chip select (active low)
+// PORTB3 (output) = MOSI, PORTB4 (input) = MISO, PORTB5 (output) = SCK
+// PORTB2 (output) = SS, driven to keep the SPI in master mode
+//
+// with DISPLAY_SPI, the row shift registers hang off the same MOSI and SCK.  the refresh
+// ISR uses the bus at any time, so the flash is read in short bursts with interrupts off
+// (FLASH_BURST bytes: about 30us, well inside a column's 1.3ms); the 595s shift the burst
+// in too, but the ISR shifts a whole column in on top before it latches anything.
+
+#ifdef MSG_FLASH
+
+#include <stdint.h>
+
+// where msgdata.bin (from tools/msgpack) is programmed into the chip
+#ifndef MSG_FLASH_BASE
+#define MSG_FLASH_BASE 0
+#endif
+
+#define FLASH_PREFETCH 16	// the read-ahead buffer (a power of 2)
+#define FLASH_BURST 8		// bytes read at a time
+
+// sets up the chip select and the SPI (after display_init(), which may have done the SPI)
+void flash_init(void);
+
+// reads n bytes from addr in one go
+void flash_read(uint32_t addr, uint8_t *buf, uint8_t n);
+
+// sequential reads, prefetched: once the buffer's down to FLASH_PREFETCH - FLASH_BURST
+// bytes, the next burst is read in behind them, so a reader taking a character at a
+// time never runs it dry and never waits for more than a burst.
+struct flash_stream
+{
+	uint32_t next;		// the flash address of the next byte to fetch
+	uint8_t head;		// where in buf the next byte to hand out is
+	uint8_t count;		// how many bytes are waiting there
+	uint8_t buf[FLASH_PREFETCH];
+};
+
+void flash_open(struct flash_stream *s, uint32_t addr);
+uint8_t flash_getc(struct flash_stream *s);
+
+#endif
+
+#endif
@@ -0,0 +1,550 @@
+// assetgen: converts font.bmp (and any sprite sheets) into PROGMEM tables
+//
+// usage: assetgen [-l layout] [-k sample.txt] [-s name:width:sheet.bmp ...]
+//                 [-a name:width:ms:sheet.bmp ...] font.bmp output-base
+// writes output-base.c and output-base.h.
+//
+// the font is a bitmap 8 pixels high, with the glyphs for ASCII 32..126 side by side in
+// cells CELL pixels wide; anything that isn't white is a lit pixel.  font.c can draw it
+// from any of these layouts, picked with -l:
+//
+//   proportional (the default)  each glyph trimmed to its inked columns (the space gets
+//       SPACE_WIDTH blank ones), with a blank column put in between characters.  smallest,
+//       and the text scrolls by quicker.
+//   fixed  CELL bytes per glyph, straight out of the bitmap.  no index to look things up in.
+//   expanded  same, but each column already spread out into a framebuf word, so drawing
+//       it is just a mask.  twice the flash.
+//
+// with the proportional layout, some pairs can do without the blank column, where the
+// facing edges wouldn't touch even diagonally ("r." or "st").  there are far too many
+// of those to list them all, so given a sample text (-k) the kerning table gets the
+// MAX_KERNS most common ones in it.
+//
+// a sprite sheet is a bitmap 8 pixels high holding frames width pixels wide, side by side.
+// red, green and yellow pixels light up in those colors and everything else is dark;
+// each column becomes a framebuf word, in sprite_name[], along with SPRITE_NAME_WIDTH
+// and SPRITE_NAME_FRAMES.
+//
+// an animation (-a) is a sprite sheet too, played at ms milliseconds a frame (10 to 1270).
+// it's packed for anim.c: each frame is a byte with the frame time in 10ms units, plus
+// ANIM_RLE if what follows is runs (count, then a column word) covering the whole frame,
+// rather than a bitmap of the columns that changed since the last frame (bit 0 of the
+// first byte is the leftmost), followed by the new words for those.  the first frame
+// is compared against a blank display.  whichever is smaller wins.  anim_name[] gets
+// ANIM_NAME_WIDTH and ANIM_NAME_FRAMES.
+//
+// this runs on the build machine, not the AVR.
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FIRST 32
+#define GLYPHS 95
+#define CELL 6
+#define SPACE_WIDTH 3
+#define BLOCK 8		// glyphs per entry in the offset table
+#define MAX_KERNS 32
+#define MAX_COLS 4096
+#define MAX_SPRITES 16
+#define ANIM_RLE 0x80
+
+enum layout { PROPORTIONAL, FIXED, EXPANDED };
+static const char *layout_names[] = { "proportional", "fixed", "expanded" };
+static enum layout layout = PROPORTIONAL;
+
+// a bitmap, one entry per column: bit 2j is green in row j (from the top), 2j+1 is red.
+// for the font, both are set for any pixel that isn't white.
+static unsigned short cols[MAX_COLS];
+static int ncols;
+
+static unsigned char font[GLYPHS * CELL];	// the font, one byte per column, bit 0 at the top
+
+static unsigned char data[GLYPHS * CELL];	// the trimmed glyphs
+static int length;
+static int offset[GLYPHS], width[GLYPHS], inked[GLYPHS];
+
+static unsigned char kerns[MAX_KERNS][2];
+static int nkerns;
+
+struct sprite
+{
+	char name[32];
+	int width, frames;
+	int ms;		// for animations; 0 for a plain sprite sheet
+	unsigned short *cols;
+};
+static struct sprite sprites[MAX_SPRITES];
+static int nsprites;
+
+static unsigned get16(const unsigned char *p) { return p[0] | p[1] << 8; }
+static unsigned long get32(const unsigned char *p) { return get16(p) | (unsigned long)get16(p + 2) << 16; }
+
+// the two bits of framebuf color for a pixel
+static unsigned short font_pixel(const unsigned char *bgr)
+{
+	return (bgr[0] != 0xff || bgr[1] != 0xff || bgr[2] != 0xff) ? 3 : 0;
+}
+
+static unsigned short sprite_pixel(const unsigned char *bgr)
+{
+	if (bgr[0] >= 0x80)
+		return 0;
+	return (bgr[1] >= 0x80 ? 1 : 0) | (bgr[2] >= 0x80 ? 2 : 0);
+}
+
+static int read_bmp(const char *path, unsigned short (*pixel)(const unsigned char *))
+{
+	static unsigned char buf[1 << 20];
+	FILE *f = fopen(path, "rb");
+	size_t n;
+	unsigned long pixels;
+	long w, h, stride, x, y;
+	if (!f) {
+		perror(path);
+		return 0;
+	}
+	n = fread(buf, 1, sizeof(buf), f);
+	fclose(f);
+	if (n < 54 || buf[0] != 'B' || buf[1] != 'M') {
+		fprintf(stderr, "%s: not a BMP file\n", path);
+		return 0;
+	}
+	pixels = get32(buf + 10);
+	w = (long)get32(buf + 18);
+	h = (long)get32(buf + 22);
+	if (get16(buf + 28) != 24 || get32(buf + 30) != 0) {
+		fprintf(stderr, "%s: only uncompressed 24-bit BMPs, please\n", path);
+		return 0;
+	}
+	if (h != 8 || w <= 0 || w > MAX_COLS) {
+		fprintf(stderr, "%s: expected a bitmap 8 pixels high\n", path);
+		return 0;
+	}
+	stride = (w * 3 + 3) & ~3;
+	if (pixels + stride * h > n) {
+		fprintf(stderr, "%s: truncated\n", path);
+		return 0;
+	}
+	// rows are stored bottom up
+	for (x = 0; x < w; ++x) {
+		unsigned short c = 0;
+		for (y = 0; y < 8; ++y)
+			c |= pixel(buf + pixels + (7 - y) * stride + x * 3) << (2 * y);
+		cols[x] = c;
+	}
+	ncols = (int)w;
+	return 1;
+}
+
+// back from framebuf words to one bit per pixel
+static unsigned char mono(unsigned short c)
+{
+	unsigned char b = 0;
+	int y;
+	for (y = 0; y < 8; ++y) {
+		if (c & (3 << (2 * y)))
+			b |= 1 << y;
+	}
+	return b;
+}
+
+static void trim_glyphs(void)
+{
+	int g, i;
+	for (g = 0; g < GLYPHS; ++g) {
+		const unsigned char *c = font + g * CELL;
+		int first = CELL, last = -1;
+		for (i = 0; i < CELL; ++i) {
+			if (c[i]) {
+				if (first == CELL)
+					first = i;
+				last = i;
+			}
+		}
+		offset[g] = length;
+		inked[g] = last >= 0;
+		if (last < 0) {
+			for (i = 0; i < SPACE_WIDTH; ++i)
+				data[length++] = 0;
+		} else {
+			for (i = first; i <= last; ++i)
+				data[length++] = c[i];
+		}
+		width[g] = length - offset[g];
+	}
+}
+
+// true if b can go right up against a with no gap
+static int kernable(int a, int b)
+{
+	unsigned char l, r, near;
+	if (a < FIRST || a >= FIRST + GLYPHS || b < FIRST || b >= FIRST + GLYPHS)
+		return 0;
+	a -= FIRST;
+	b -= FIRST;
+	if (!inked[a] || !inked[b])
+		return 0;
+	l = data[offset[a] + width[a] - 1];
+	r = data[offset[b]];
+	near = r | (r << 1) | (r >> 1);
+	return (l & near) == 0;
+}
+
+static int count_kerns(const char *path)
+{
+	static int freq[GLYPHS][GLYPHS];
+	FILE *f = fopen(path, "r");
+	int c, prev = 0, a, b, i;
+	if (!f) {
+		perror(path);
+		return 0;
+	}
+	while ((c = getc(f)) != EOF) {
+		if (kernable(prev, c))
+			++freq[prev - FIRST][c - FIRST];
+		prev = c;
+	}
+	fclose(f);
+
+	// pick the most common, then sort them for the lookup
+	for (nkerns = 0; nkerns < MAX_KERNS; ++nkerns) {
+		int best = 0;
+		for (a = 0; a < GLYPHS; ++a) {
+			for (b = 0; b < GLYPHS; ++b) {
+				if (freq[a][b] > best) {
+					best = freq[a][b];
+					kerns[nkerns][0] = FIRST + a;
+					kerns[nkerns][1] = FIRST + b;
+				}
+			}
+		}
+		if (best < 2)
+			break;
+		freq[kerns[nkerns][0] - FIRST][kerns[nkerns][1] - FIRST] = 0;
+	}
+	for (i = 1; i < nkerns; ++i) {
+		for (a = i; a > 0 && memcmp(kerns[a - 1], kerns[a], 2) > 0; --a) {
+			unsigned char t[2];
+			memcpy(t, kerns[a], 2);
+			memcpy(kerns[a], kerns[a - 1], 2);
+			memcpy(kerns[a - 1], t, 2);
+		}
+	}
+	return 1;
+}
+
+// -s name:width:sheet.bmp, or -a name:width:ms:sheet.bmp
+static int read_sprite(char *arg, int anim)
+{
+	struct sprite *s = &sprites[nsprites];
+	char *w = strchr(arg, ':'), *ms = w && anim ? strchr(w + 1, ':') : w;
+	char *path = ms ? strchr(ms + 1, ':') : NULL;
+	char *p;
+	if (!path || w == arg || w - arg >= (int)sizeof(s->name)) {
+		fprintf(stderr, anim ? "-a wants name:width:ms:sheet.bmp\n" : "-s wants name:width:sheet.bmp\n");
+		return 0;
+	}
+	if (nsprites == MAX_SPRITES) {
+		fprintf(stderr, "too many sprite sheets\n");
+		return 0;
+	}
+	*w++ = 0;
+	*path++ = 0;
+	for (p = arg; *p; ++p) {
+		if (!isalnum((unsigned char)*p) && *p != '_') {
+			fprintf(stderr, "%s: sprite names have to be identifiers\n", arg);
+			return 0;
+		}
+	}
+	strcpy(s->name, arg);
+	s->width = atoi(w);
+	s->ms = anim ? atoi(ms + 1) : 0;
+	if (anim && (s->ms < 10 || s->ms > 1270)) {
+		fprintf(stderr, "%s: frame times go from 10 to 1270ms\n", arg);
+		return 0;
+	}
+	if (!read_bmp(path, sprite_pixel))
+		return 0;
+	if (s->width <= 0 || ncols % s->width) {
+		fprintf(stderr, "%s: not a whole number of frames %s pixels wide\n", path, w);
+		return 0;
+	}
+	s->frames = ncols / s->width;
+	s->cols = malloc(ncols * sizeof(*s->cols));
+	memcpy(s->cols, cols, ncols * sizeof(*s->cols));
+	++nsprites;
+	return 1;
+}
+
+static void char_literal(FILE *f, int c)
+{
+	if (c == '\'' || c == '\\')
+		fprintf(f, "'\\%c'", c);
+	else
+		fprintf(f, "'%c'", c);
+}
+
+static unsigned short expand(unsigned char b)
+{
+	unsigned short w = 0;
+	int y;
+	for (y = 0; y < 8; ++y) {
+		if (b & (1 << y))
+			w |= 3 << (2 * y);
+	}
+	return w;
+}
+
+// one line of table per glyph, with the character in a comment
+static void glyph_line(FILE *f, int g, const unsigned char *c, int n, int words)
+{
+	int i;
+	fprintf(f, " ");
+	for (i = 0; i < n; ++i) {
+		if (words)
+			fprintf(f, " 0x%04x,", expand(c[i]));
+		else
+			fprintf(f, " 0x%02x,", c[i]);
+	}
+	fprintf(f, "%*s// ", words ? 1 : (CELL - n) * 6 + 1, "");
+	char_literal(f, FIRST + g);
+	fprintf(f, "\n");
+}
+
+static void write_font(FILE *f)
+{
+	int g, i;
+	if (layout != PROPORTIONAL) {
+		fprintf(f, "const %s font_data[] PROGMEM =\n{\n", layout == EXPANDED ? "uint16_t" : "uint8_t");
+		for (g = 0; g < GLYPHS; ++g)
+			glyph_line(f, g, font + g * CELL, CELL, layout == EXPANDED);
+		fprintf(f, "};\n");
+		return;
+	}
+
+	fprintf(f, "const uint8_t font_data[] PROGMEM =\n{\n");
+	for (g = 0; g < GLYPHS; ++g)
+		glyph_line(f, g, data + offset[g], width[g], 0);
+	fprintf(f, "};\n\n");
+
+	fprintf(f, "const uint16_t font_block[] PROGMEM =\n{");
+	for (g = 0; g < GLYPHS; g += BLOCK)
+		fprintf(f, "%s%4d,", (g % (BLOCK * 8)) ? " " : "\n  ", offset[g]);
+	fprintf(f, "\n};\n\n");
+
+	fprintf(f, "const uint8_t font_width[] PROGMEM =\n{");
+	for (g = 0; g < GLYPHS; g += 2)
+		fprintf(f, "%s0x%02x,", (g % 32) ? " " : "\n  ", width[g] | (g + 1 < GLYPHS ? width[g + 1] << 4 : 0));
+	fprintf(f, "\n};\n\n");
+
+	fprintf(f, "const char font_kern[][2] PROGMEM =\n{\n");
+	for (i = 0; i < nkerns; ++i) {
+		fprintf(f, "  { ");
+		char_literal(f, kerns[i][0]);
+		fprintf(f, ", ");
+		char_literal(f, kerns[i][1]);
+		fprintf(f, " },\n");
+	}
+	if (nkerns == 0)
+		fprintf(f, "  { 0, 0 }\n");
+	fprintf(f, "};\n");
+}
+
+// how many of the next columns (up to left) are the same as the first, at most 255
+static int run_length(const unsigned short *c, int left)
+{
+	int n = 1;
+	while (n < left && n < 255 && c[n] == c[0])
+		++n;
+	return n;
+}
+
+// writes animation s; returns its size in bytes
+static int write_anim(FILE *f, const struct sprite *s)
+{
+	int i, j, size = 0, ticks = (s->ms + 5) / 10;
+	const unsigned short *prev = NULL;
+	fprintf(f, "const uint8_t anim_%s[] PROGMEM =\n{\n", s->name);
+	for (i = 0; i < s->frames; ++i) {
+		const unsigned short *c = s->cols + i * s->width;
+		int changed = 0, runs = 0;
+		for (j = 0; j < s->width; ++j) {
+			if (c[j] != (prev ? prev[j] : 0))
+				++changed;
+		}
+		for (j = 0; j < s->width; j += run_length(c + j, s->width - j))
+			++runs;
+		if (3 * runs < (s->width + 7) / 8 + 2 * changed) {
+			fprintf(f, "  0x%02x,", ANIM_RLE | ticks);
+			for (j = 0; j < s->width; ) {
+				int n = run_length(c + j, s->width - j);
+				fprintf(f, " %d, 0x%02x, 0x%02x,", n, c[j] & 0xff, c[j] >> 8);
+				j += n;
+			}
+			size += 1 + 3 * runs;
+		} else {
+			fprintf(f, "  0x%02x,", ticks);
+			for (j = 0; j < s->width; j += 8) {
+				int k, bits = 0;
+				for (k = 0; k < 8 && j + k < s->width; ++k) {
+					if (c[j + k] != (prev ? prev[j + k] : 0))
+						bits |= 1 << k;
+				}
+				fprintf(f, " 0x%02x,", bits);
+			}
+			for (j = 0; j < s->width; ++j) {
+				if (c[j] != (prev ? prev[j] : 0))
+					fprintf(f, " 0x%02x, 0x%02x,", c[j] & 0xff, c[j] >> 8);
+			}
+			size += 1 + (s->width + 7) / 8 + 2 * changed;
+		}
+		fprintf(f, "\n");
+		prev = c;
+	}
+	fprintf(f, "};\n");
+	return size;
+}
+
+static void upper(FILE *f, const char *s)
+{
+	while (*s)
+		putc(toupper((unsigned char)*s++), f);
+}
+
+static int write_output(const char *base)
+{
+	char path[1024];
+	FILE *f;
+	int i, j, size;
+
+	snprintf(path, sizeof(path), "%s.h", base);
+	if (!(f = fopen(path, "w"))) {
+		perror(path);
+		return 0;
+	}
+	fprintf(f, "// generated by tools/assetgen; do not edit\n\n");
+	fprintf(f, "#include <stdint.h>\n#include <avr/pgmspace.h>\n\n");
+	fprintf(f, "#define FONT_FIRST %d\n", FIRST);
+	fprintf(f, "#define FONT_GLYPHS %d\n", GLYPHS);
+	switch (layout) {
+	case PROPORTIONAL:
+		fprintf(f, "#define FONT_PROPORTIONAL 1\n");
+		fprintf(f, "#define FONT_BLOCK %d\n", BLOCK);
+		fprintf(f, "#define FONT_KERNS %d\n\n", nkerns);
+		fprintf(f, "extern const uint8_t font_data[] PROGMEM;\n");
+		fprintf(f, "extern const uint16_t font_block[] PROGMEM;\n");
+		fprintf(f, "extern const uint8_t font_width[] PROGMEM;\n");
+		fprintf(f, "extern const char font_kern[][2] PROGMEM;\n");
+		break;
+	case FIXED:
+		fprintf(f, "#define FONT_FIXED 1\n");
+		fprintf(f, "#define FONT_CELL %d\n\n", CELL);
+		fprintf(f, "extern const uint8_t font_data[] PROGMEM;\n");
+		break;
+	case EXPANDED:
+		fprintf(f, "#define FONT_EXPANDED 1\n");
+		fprintf(f, "#define FONT_CELL %d\n\n", CELL);
+		fprintf(f, "extern const uint16_t font_data[] PROGMEM;\n");
+		break;
+	}
+	for (i = 0; i < nsprites; ++i) {
+		const char *kind = sprites[i].ms ? "ANIM_" : "SPRITE_";
+		fprintf(f, "\n#define %s", kind);
+		upper(f, sprites[i].name);
+		fprintf(f, "_WIDTH %d\n#define %s", sprites[i].width, kind);
+		upper(f, sprites[i].name);
+		fprintf(f, "_FRAMES %d\n", sprites[i].frames);
+		fprintf(f, "extern const %s %s%s[] PROGMEM;\n", sprites[i].ms ? "uint8_t" : "uint16_t",
+			sprites[i].ms ? "anim_" : "sprite_", sprites[i].name);
+	}
+	fclose(f);
+
+	snprintf(path, sizeof(path), "%s.c", base);
+	if (!(f = fopen(path, "w"))) {
+		perror(path);
+		return 0;
+	}
+	switch (layout) {
+	case PROPORTIONAL:
+		size = length + (GLYPHS + BLOCK - 1) / BLOCK * 2 + (GLYPHS + 1) / 2 + nkerns * 2;
+		break;
+	case FIXED:
+		size = GLYPHS * CELL;
+		break;
+	default:
+		size = GLYPHS * CELL * 2;
+		break;
+	}
+	fprintf(f, "// generated by tools/assetgen; do not edit\n");
+	fprintf(f, "// %s font, %d bytes", layout_names[layout], size);
+	if (layout == PROPORTIONAL)
+		fprintf(f, " including %d kerning pairs", nkerns);
+	fprintf(f, "\n\n#include \"%s.h\"\n\n", base);
+	write_font(f);
+
+	for (i = 0; i < nsprites; ++i) {
+		struct sprite *s = &sprites[i];
+		fprintf(f, "\n// %d frames of %d columns\n", s->frames, s->width);
+		if (s->ms) {
+			size += write_anim(f, s);
+			continue;
+		}
+		fprintf(f, "const uint16_t sprite_%s[] PROGMEM =\n{", s->name);
+		for (j = 0; j < s->frames * s->width; ++j)
+			fprintf(f, "%s0x%04x,", (j % s->width) ? " " : "\n  ", s->cols[j]);
+		fprintf(f, "\n};\n");
+		size += s->frames * s->width * 2;
+	}
+	fclose(f);
+
+	fprintf(stderr, "assetgen: %s font", layout_names[layout]);
+	if (layout == PROPORTIONAL)
+		fprintf(stderr, " with %d kerning pairs", nkerns);
+	fprintf(stderr, ", %d sprite sheets and animations, %d bytes\n", nsprites, size);
+	return 1;
+}
+
+static int usage(const char *argv0)
+{
+	fprintf(stderr, "usage: %s [-l proportional|fixed|expanded] [-k sample.txt] "
+		"[-s name:width:sheet.bmp ...] [-a name:width:ms:sheet.bmp ...] font.bmp output-base\n", argv0);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	const char *sample = NULL;
+	int i, g;
+	for (i = 1; i + 1 < argc && argv[i][0] == '-'; i += 2) {
+		if (!strcmp(argv[i], "-l")) {
+			for (g = 0; g < 3 && strcmp(argv[i + 1], layout_names[g]); ++g);
+			if (g == 3)
+				return usage(argv[0]);
+			layout = (enum layout)g;
+		} else if (!strcmp(argv[i], "-k")) {
+			sample = argv[i + 1];
+		} else if (!strcmp(argv[i], "-s") || !strcmp(argv[i], "-a")) {
+			if (!read_sprite(argv[i + 1], argv[i][1] == 'a'))
+				return 1;
+		} else {
+			return usage(argv[0]);
+		}
+	}
+	if (argc - i != 2)
+		return usage(argv[0]);
+
+	if (!read_bmp(argv[i], font_pixel))
+		return 1;
+	if (ncols < GLYPHS * CELL) {
+		fprintf(stderr, "%s: need %d glyphs %d pixels wide\n", argv[i], GLYPHS, CELL);
+		return 1;
+	}
+	for (g = 0; g < GLYPHS * CELL; ++g)
+		font[g] = mono(cols[g]);
+	trim_glyphs();
+	if (sample && layout == PROPORTIONAL && !count_kerns(sample))
+		return 1;
+	return write_output(argv[i + 1]) ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+// msgpack: compresses messages.txt into PROGMEM tables for messages.c
+//
+// usage: msgpack messages.txt msgdata
+// writes msgdata.c and msgdata.h, and msgdata.bin: the index and the packed text
+// as an image for an external SPI flash (see spiflash.h).  the image starts with
+// MESSAGE_COUNT little-endian words, each the offset of a message from the end of
+// the index, followed by the text.  the pairs stay in the AVR's flash either way.
+//
+// one message per line, printable ASCII only.  the compression is byte pair encoding:
+// codes 128..255 each stand for a pair of codes, found by repeatedly replacing the most
+// common adjacent pair in the text.  pairs never span two messages, so each message can
+// be decoded on its own, and the nesting depth is capped so the decoder's stack is small.
+//
+// this runs on the build machine, not the AVR.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_MESSAGES 1024
+#define MAX_TEXT 65536
+#define FIRST_PAIR 128
+#define MAX_PAIRS 128
+#define MAX_DEPTH 8
+
+static unsigned char text[MAX_TEXT];	// all messages, each followed by a 0
+static int length;
+static int count;
+
+static unsigned char pairs[MAX_PAIRS][2];
+static int npairs;
+static int depth[256];
+
+static int read_messages(const char *path)
+{
+	char line[1024];
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		return 0;
+	}
+	while (fgets(line, sizeof(line), f)) {
+		size_t n = strcspn(line, "\r\n");
+		size_t i;
+		if (n == 0)
+			continue;
+		if (count == MAX_MESSAGES || length + n + 1 > MAX_TEXT) {
+			fprintf(stderr, "%s: too many messages\n", path);
+			return 0;
+		}
+		for (i = 0; i < n; ++i) {
+			unsigned char c = line[i];
+			if (c < 32 || c > 126) {
+				fprintf(stderr, "%s:%d: not printable ASCII\n", path, count + 1);
+				return 0;
+			}
+			text[length++] = c;
+		}
+		text[length++] = 0;
+		++count;
+	}
+	fclose(f);
+	return 1;
+}
+
+// finds the most common pair that's still shallow enough; returns its count
+static int best_pair(int *a, int *b)
+{
+	static int freq[256][256];
+	int i, j, best = 0;
+	memset(freq, 0, sizeof(freq));
+	for (i = 0; i + 1 < length; ++i) {
+		if (text[i] && text[i + 1])
+			++freq[text[i]][text[i + 1]];
+	}
+	for (i = 1; i < 256; ++i) {
+		for (j = 1; j < 256; ++j) {
+			int d = 1 + (depth[i] > depth[j] ? depth[i] : depth[j]);
+			if (freq[i][j] > best && d <= MAX_DEPTH) {
+				best = freq[i][j];
+				*a = i;
+				*b = j;
+			}
+		}
+	}
+	return best;
+}
+
+static void compress(void)
+{
+	int a, b;
+	// a new pair costs 2 bytes of table, so it has to show up at least 3 times
+	while (npairs < MAX_PAIRS && best_pair(&a, &b) >= 3) {
+		int code = FIRST_PAIR + npairs, i, j;
+		pairs[npairs][0] = a;
+		pairs[npairs][1] = b;
+		depth[code] = 1 + (depth[a] > depth[b] ? depth[a] : depth[b]);
+		++npairs;
+		for (i = j = 0; i < length; ++i) {
+			if (i + 1 < length && text[i] == a && text[i + 1] == b) {
+				text[j++] = code;
+				++i;
+			} else {
+				text[j++] = text[i];
+			}
+		}
+		length = j;
+	}
+}
+
+static int write_output(const char *base, int original)
+{
+	char path[1024];
+	FILE *f;
+	int i, n, maxdepth = 0;
+
+	for (i = 0; i < npairs; ++i) {
+		if (depth[FIRST_PAIR + i] > maxdepth)
+			maxdepth = depth[FIRST_PAIR + i];
+	}
+
+	snprintf(path, sizeof(path), "%s.h", base);
+	if (!(f = fopen(path, "w"))) {
+		perror(path);
+		return 0;
+	}
+	fprintf(f, "// generated by tools/msgpack; do not edit\n\n");
+	fprintf(f, "#define MESSAGE_COUNT %d\n", count);
+	fprintf(f, "#define MSG_PAIRS %d\n", npairs);
+	fprintf(f, "#define MSG_DEPTH %d\n", maxdepth > 0 ? maxdepth : 1);
+	fclose(f);
+
+	snprintf(path, sizeof(path), "%s.c", base);
+	if (!(f = fopen(path, "w"))) {
+		perror(path);
+		return 0;
+	}
+	fprintf(f, "// generated by tools/msgpack; do not edit\n");
+	fprintf(f, "// %d messages, %d bytes of text packed into %d + %d bytes of pairs\n\n",
+		count, original, length, npairs * 2);
+	fprintf(f, "#include \"messages.h\"\n\n");
+
+	fprintf(f, "const uint8_t msg_pairs[][2] PROGMEM =\n{\n");
+	for (i = 0; i < npairs; ++i)
+		fprintf(f, "  { %3d, %3d },\n", pairs[i][0], pairs[i][1]);
+	if (npairs == 0)
+		fprintf(f, "  { 0, 0 }\n");
+	fprintf(f, "};\n\n");
+
+	fprintf(f, "#ifndef MSG_FLASH\n\n");
+	fprintf(f, "const uint16_t msg_index[MESSAGE_COUNT] PROGMEM =\n{");
+	for (i = n = 0; i < length; ++i) {
+		if (i == 0 || text[i - 1] == 0)
+			fprintf(f, "%s%5d,", (n++ % 10) ? " " : "\n  ", i);
+	}
+	fprintf(f, "\n};\n\n");
+
+	fprintf(f, "const uint8_t msg_data[] PROGMEM =\n{");
+	for (i = 0; i < length; ++i)
+		fprintf(f, "%s%3d,", (i % 16) ? " " : "\n  ", text[i]);
+	fprintf(f, "\n};\n\n");
+	fprintf(f, "#endif\n");
+	fclose(f);
+
+	snprintf(path, sizeof(path), "%s.bin", base);
+	if (!(f = fopen(path, "wb"))) {
+		perror(path);
+		return 0;
+	}
+	for (i = 0; i < length; ++i) {
+		if (i == 0 || text[i - 1] == 0) {
+			fputc(i & 0xff, f);
+			fputc(i >> 8, f);
+		}
+	}
+	fwrite(text, 1, length, f);
+	fclose(f);
+
+	fprintf(stderr, "msgpack: %d messages, %d bytes -> %d bytes\n", count, original, length + npairs * 2);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	int original;
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s messages.txt output-base\n", argv[0]);
+		return 1;
+	}
+	if (!read_messages(argv[1]))
+		return 1;
+	if (count == 0) {
+		fprintf(stderr, "%s: no messages\n", argv[1]);
+		return 1;
+	}
+	original = length;
+	compress();
+	return write_output(argv[2], original) ? 0 : 1;
+}
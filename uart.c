@@ -0,0 +1,56 @@
+// serial input (see uart.h)
+//
+// the receive interrupt is the only writer of ring_head and the foreground the only
+// writer of ring_tail, so neither side ever has to turn interrupts off.
+
+#ifdef UART
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "uart.h"
+
+#define BAUD 38400
+#define UBRR_VALUE ((F_CPU / 8 + BAUD / 2) / BAUD - 1)	// with U2X
+
+static uint8_t ring[UART_RING];
+static volatile uint8_t ring_head, ring_tail;
+
+ISR(USART_RX_vect)
+{
+	uint8_t c = UDR0;
+	uint8_t h = ring_head, next = (h + 1) & (UART_RING - 1);
+	if (next != ring_tail) {
+		ring[h] = c;
+		ring_head = next;
+	}
+}
+
+void uart_init(void)
+{
+	UBRR0 = UBRR_VALUE;
+	UCSR0A = (1 << U2X0);
+	UCSR0C = (1 << UCSZ01) | (1 << UCSZ00);	// 8N1
+	UCSR0B = (1 << RXCIE0) | (1 << RXEN0);
+}
+
+uint8_t uart_pending(void)
+{
+	return ring_head != ring_tail;
+}
+
+int16_t uart_getc(void)
+{
+	uint8_t t = ring_tail, c;
+	if (t == ring_head)
+		return -1;
+	c = ring[t];
+	ring_tail = (t + 1) & (UART_RING - 1);
+	return c;
+}
+
+#if UART_RING & (UART_RING - 1)
+#error "UART_RING must be a power of 2"
+#endif
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef UART_H
+#define UART_H
+
+// serial input, built in with -DUART: 38400 baud, 8N1, receive only.
+//
+// RXD is PD0, which is normally the rightmost column driver, so in this build that
+// column is driven from PB0 instead (see display.c).
+//
+// what comes in:
+//   printable characters   scrolled across the display
+//   UART_GREEN, UART_RED, UART_ORANGE   set the color for the text after them
+//   UART_PALETTE + 1 byte   recolors the whole display with PALETTE() (see display.h),
+//                          until the host goes quiet
+//   UART_FRAME + 2 * DISPLAY_WIDTH bytes   a raw frame: one framebuf word per column,
+//                          left to right, low byte first.  it's drawn on the back page,
+//                          which is then flipped to the front.
+// anything else is ignored.
+
+#ifdef UART
+
+#include <stdint.h>
+
+#define UART_FRAME  0x02	// STX
+#define UART_GREEN  0x11	// DC1..DC3
+#define UART_RED    0x12
+#define UART_ORANGE 0x13
+#define UART_PALETTE 0x14	// DC4
+
+// bytes the receive interrupt has room to hold before it starts dropping them
+#define UART_RING 64
+
+// enables the receiver and its interrupt
+void uart_init(void);
+
+// true if there's anything waiting
+uint8_t uart_pending(void);
+
+// the next byte received, or -1 if there isn't one
+int16_t uart_getc(void);
+
+#endif
+
+#endif